@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""Writes xtrans inputs for C5G7-like pin lattices.
+
+The core is a checkerboard of 17x17 UO2 and MOX assemblies, with one
+assembly-wide moderator reflector on the xmax/ymax sides. Reflective
+boundaries are on xmin/ymin, which makes it a quarter core as in C5G7.
+Every pin is one coarse cell of homogenized material. The usual guide
+tube positions and a central fission chamber are kept, and MOX
+assemblies use three enrichment zones. In 3D the lattice is extruded
+over --layers cells, and a top moderator layer is added when --reflector
+is on.
+
+The cross sections are synthetic. Each material has the C5G7 role and
+ordering (1 UO2, 2 MOX 4.3%, 3 MOX 7.0%, 4 MOX 8.7%, 5 fission chamber,
+6 guide tube, 7 moderator). They are generated for any group count from
+1 to 30 with downscatter only. They are not the benchmark data, and they
+are meant for performance work only.
+
+    generate_inputs.py --assemblies 2 --groups 7 --sn 8 --name c5g7-2x2
+
+writes c5g7-2x2.prm and c5g7-2x2-mid.txt. The input profiles itself
+into <name>-profile.json and streams telemetry to <name>-telemetry.jsonl.
+"""
+
+import argparse
+import math
+import os
+
+UO2, MOX43, MOX70, MOX87, CHAMBER, GUIDE, MODERATOR = range(1, 8)
+N_MATERIALS = 7
+PINS = 17
+
+# guide tube positions of a 17x17 assembly (upper-left quadrant and its
+# mirror images), fission chamber at the centre
+GUIDE_TUBES = set()
+for i, j in [(2, 5), (2, 8), (3, 3), (5, 2), (5, 5), (5, 8), (8, 2), (8, 5)]:
+    for a, b in [(i, j), (j, i)]:
+        for x in (a, PINS - 1 - a):
+            for y in (b, PINS - 1 - b):
+                GUIDE_TUBES.add((x, y))
+GUIDE_TUBES.discard((8, 8))
+
+
+def pin_material(assembly_kind, x, y):
+    if (x, y) == (8, 8):
+        return CHAMBER
+    if (x, y) in GUIDE_TUBES:
+        return GUIDE
+    if assembly_kind == UO2:
+        return UO2
+    ring = min(x, y, PINS - 1 - x, PINS - 1 - y)
+    if ring == 0:
+        return MOX43
+    if ring <= 2:
+        return MOX70
+    return MOX87
+
+
+def material_map(n_assemblies, reflector, layers):
+    """Material ids in the order MeshGenerator reads them: x fastest,
+    then y, then z."""
+    n_fuel = n_assemblies * PINS
+    n = n_fuel + (PINS if reflector else 0)
+    plane = []
+    for y in range(n):
+        row = []
+        for x in range(n):
+            if x >= n_fuel or y >= n_fuel:
+                row.append(MODERATOR)
+            else:
+                ax, ay = x // PINS, y // PINS
+                kind = UO2 if (ax + ay) % 2 == 0 else MOX43
+                row.append(pin_material(kind, x % PINS, y % PINS))
+        plane.append(row)
+    planes = [plane] * layers
+    if reflector and layers > 1:
+        planes = planes + [[[MODERATOR] * n for _ in range(n)]]
+    return planes
+
+
+def cross_sections(n_groups):
+    """sigma_t, sigma_s[g_in][g], nu_sigf, chi per material, downscatter
+    only. Fast groups scatter more and absorb less than thermal ones."""
+    data = {}
+    for m in range(1, N_MATERIALS + 1):
+        fissile = m in (UO2, MOX43, MOX70, MOX87, CHAMBER)
+        strength = {UO2: 1.0, MOX43: 1.1, MOX70: 1.25, MOX87: 1.4,
+                    CHAMBER: 1e-4}.get(m, 0.0)
+        moderating = 1.3 if m in (MODERATOR, GUIDE) else 1.0
+        sigt, sigs, nusigf, chi = [], [], [], []
+        for g in range(n_groups):
+            # lethargy-like position of the group, 0 fast to 1 thermal
+            u = g / max(1, n_groups - 1)
+            t = (0.2 + 1.6 * u) * moderating
+            absorption = (0.005 + 0.08 * u) * (1.0 + strength)
+            if m in (MODERATOR, GUIDE):
+                absorption = 0.0005 + 0.02 * u
+            sigt.append(t)
+            scat = t - absorption
+            row = [0.0] * n_groups
+            # in-group share grows towards thermal, the rest goes down
+            within = scat * (0.6 + 0.35 * u) if g + 1 < n_groups else scat
+            row[g] = within
+            down = scat - within
+            below = list(range(g + 1, n_groups))
+            weights = [0.5 ** k for k in range(len(below))]
+            for k, gout in enumerate(below):
+                row[gout] = down * weights[k] / sum(weights)
+            sigs.append(row)
+            nusigf.append(2.4 * absorption * 0.6 * strength if fissile else 0.0)
+            chi.append(math.exp(-4.0 * u))
+        total = sum(chi)
+        data[m] = (sigt, sigs, nusigf, [c / total for c in chi])
+    return data
+
+
+def fmt(values):
+    return ", ".join("%.8g" % v for v in values)
+
+
+def write_input(args, mid_name):
+    n_cells = args.assemblies * PINS + (PINS if args.reflector else 0)
+    n_z = args.layers + (1 if args.reflector and args.layers > 1 else 0)
+    pitch = 1.26
+    lines = [
+        "set problem dimension                        = %d" % args.dim,
+        "set transport model                          = ep",
+        "set angular quadrature name                  = %s" % args.quadrature,
+        "set angular quadrature order                 = %d" % args.sn,
+        "set do print angular quadrature info         = false",
+        "set number of groups                         = %d" % args.groups,
+        "set do eigenvalue calculations               = true",
+        "set do NDA                                   = false",
+        "set have reflective BC                       = true",
+        "set reflective boundary names                = xmin, ymin",
+        "set uniform refinements                      = %d" % args.refinements,
+        "set linear solver name                       = %s" % args.solver,
+        "set preconditioner name                      = %s" % args.preconditioner,
+        "set x, y, z max values of boundary locations = %g, %g, %g"
+        % (n_cells * pitch, n_cells * pitch, n_z * args.layer_height),
+        "set number of cells for x, y, z directions   = %d, %d, %d" % (n_cells, n_cells, n_z),
+        "set number of materials                      = %d" % N_MATERIALS,
+        "set spatial discretization                   = %s" % args.discretization,
+        "set finite element polynomial degree         = %d" % args.fe_order,
+        "set load balancing                           = %s" % args.load_balancing,
+        "set output file name base                    = %s" % args.name,
+        "set output format                            = none",
+        "set do profiling                             = true",
+        "set telemetry file name                      = %s-telemetry.jsonl" % args.name,
+        "",
+        "subsection material ID map",
+        "set material id file name                    = %s" % mid_name,
+        "end",
+        "",
+        "subsection fissile material IDs",
+        "set fissile material ids                     = 1, 2, 3, 4, 5",
+        "end",
+        "",
+    ]
+    xs = cross_sections(args.groups)
+    if args.groups == 1:
+        for title, index in [("sigma_t", 0), ("nu_sigf", 2), ("ksi", 3)]:
+            lines += ["subsection one-group %s" % title,
+                      "set values = %s" % fmt([xs[m][index][0] for m in sorted(xs)]),
+                      "end", ""]
+        lines += ["subsection one-group sigma_s",
+                  "set values = %s" % fmt([xs[m][1][0][0] for m in sorted(xs)]),
+                  "end", ""]
+    else:
+        for title, index in [("sigma_t", 0), ("nu_sigf", 2), ("ksi", 3)]:
+            lines.append("subsection %s, group=1 to G" % title)
+            for m in sorted(xs):
+                lines.append("set material %d = %s" % (m, fmt(xs[m][index])))
+            lines += ["end", ""]
+        for m in sorted(xs):
+            lines.append("subsection sigma_s, material %d" % m)
+            for gin, row in enumerate(xs[m][1]):
+                lines.append("set g_in=%d = %s" % (gin + 1, fmt(row)))
+            lines += ["end", ""]
+    return "\n".join(lines)
+
+
+def parse_args(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--name", default="c5g7", help="name base of the input, mid file and outputs")
+    parser.add_argument("--directory", default=".", help="where the files go")
+    parser.add_argument("--dim", type=int, default=2, choices=(2, 3))
+    parser.add_argument("--assemblies", type=int, default=2, help="fuel assemblies per side")
+    parser.add_argument("--reflector", type=int, default=1, choices=(0, 1),
+                        help="add a moderator assembly row on xmax/ymax (and a top layer in 3D)")
+    parser.add_argument("--layers", type=int, default=1, help="axial fuel layers in 3D")
+    parser.add_argument("--layer-height", type=float, default=1.26)
+    parser.add_argument("--groups", type=int, default=7)
+    parser.add_argument("--sn", type=int, default=8)
+    parser.add_argument("--quadrature", default="lsgc")
+    parser.add_argument("--fe-order", type=int, default=1)
+    parser.add_argument("--discretization", default="dfem", choices=("dfem", "cfem"))
+    parser.add_argument("--refinements", type=int, default=0)
+    parser.add_argument("--solver", default="cg")
+    parser.add_argument("--preconditioner", default="amg")
+    parser.add_argument("--load-balancing", default="none")
+    args = parser.parse_args(argv)
+    if args.dim == 2:
+        args.layers = 1
+    if not 1 <= args.groups <= 30:
+        parser.error("xtrans declares at most 30 groups")
+    # the C5G7 symmetry relies on an even set; EP needs an even order anyway
+    if args.sn % 2:
+        parser.error("the SN order must be even")
+    return args
+
+
+def main(argv=None):
+    args = parse_args(argv)
+    os.makedirs(args.directory, exist_ok=True)
+    mid_name = args.name + "-mid.txt"
+    planes = material_map(args.assemblies, args.reflector, args.layers)
+    with open(os.path.join(args.directory, mid_name), "w") as out:
+        for plane in planes:
+            for row in plane:
+                out.write(" ".join(str(m) for m in row) + "\n")
+            out.write("\n")
+    with open(os.path.join(args.directory, args.name + ".prm"), "w") as out:
+        out.write(write_input(args, mid_name) + "\n")
+    n = len(planes[0])
+    cells = n * n * len(planes) * (2 ** args.dim) ** args.refinements
+    print("%s: %d cells, %d groups, S%d" % (args.name, cells, args.groups, args.sn))
+    return cells
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""Strong and weak scaling driver for xtrans.
+
+For every rank (and thread) count, this script:
+1. writes a C5G7-like input with generate_inputs.py;
+2. runs xtrans through the launcher;
+3. reads the profile (<name>-profile.json) and telemetry
+   (<name>-telemetry.jsonl) that the input asks for.
+
+It then tabulates the time of each solver phase with speedup and
+efficiency against the smallest run. The time is the maximum over ranks,
+summed over every place the phase appears in the section tree.
+
+Strong scaling keeps the problem fixed. Weak scaling grows it with the
+rank count: the assemblies per side scale with sqrt(ranks) in 2D, and
+the axial layers scale linearly in 3D. Efficiency uses the actual cells
+per rank, so rounding the lattice size does not distort it.
+
+    run_scaling.py --mode strong --ranks 1,2,4,8 --xtrans ../../xtrans
+    run_scaling.py --mode weak --ranks 1,4,16 --assemblies 1 --groups 7
+
+Results go to <workdir>/<mode>-scaling.md and .csv, and the table is
+printed. xtrans runs one thread per rank. --threads only sets
+OMP_NUM_THREADS for PETSc/BLAS and labels the rows.
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import generate_inputs  # noqa: E402
+
+PHASES = [
+    "assemble_ho_volume_boundary",
+    "assemble_ho_interface",
+    "initialize_ho_preconditioners",
+    "generate_ho_rhs",
+    "ho_solve",
+    "generate_moments",
+    "angular_multigrid_correction",
+    "estimate_phi_diff",
+    "run",
+]
+EFFICIENCY_THRESHOLD = 0.8
+
+
+def int_list(text):
+    return [int(v) for v in text.split(",") if v.strip()]
+
+
+def phase_times(profile):
+    times = dict((phase, 0.0) for phase in PHASES)
+    for section in profile["sections"]:
+        leaf = section["name"].split("/")[-1]
+        if leaf in times:
+            times[leaf] += section["wall_max"]
+    return times
+
+
+def read_telemetry(path):
+    sweeps, generations, memory = 0, 0, 0.0
+    if not os.path.exists(path):
+        return sweeps, generations, memory
+    with open(path) as stream:
+        for line in stream:
+            record = json.loads(line)
+            if record["event"] == "si":
+                sweeps += 1
+            else:
+                generations += 1
+            memory = max(memory, record.get("memory_hwm_mb_max") or 0.0)
+    return sweeps, generations, memory
+
+
+def case_arguments(args, ranks):
+    """Generator arguments of the run on the given number of ranks."""
+    assemblies, layers = args.assemblies, args.layers
+    if args.mode == "weak":
+        ratio = ranks / float(args.ranks[0])
+        if args.dim == 2:
+            assemblies = max(1, int(round(args.assemblies * math.sqrt(ratio))))
+        else:
+            layers = max(1, int(round(args.layers * ratio)))
+    return ["--dim", str(args.dim),
+            "--assemblies", str(assemblies),
+            "--layers", str(layers),
+            "--groups", str(args.groups),
+            "--sn", str(args.sn),
+            "--fe-order", str(args.fe_order),
+            "--discretization", args.discretization,
+            "--refinements", str(args.refinements),
+            "--solver", args.solver,
+            "--preconditioner", args.preconditioner,
+            "--load-balancing", args.load_balancing]
+
+
+def run_case(args, ranks, threads):
+    name = "%s-r%d-t%d" % (args.mode, ranks, threads)
+    directory = os.path.join(args.workdir, name)
+    cells = generate_inputs.main(case_arguments(args, ranks) +
+                                 ["--name", name, "--directory", directory])
+    command = shlex.split(args.launcher.format(ranks=ranks, threads=threads))
+    command += [os.path.abspath(args.xtrans), name + ".prm"]
+    print(" ".join(command))
+    if args.dry_run:
+        return None
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    start = time.time()
+    with open(os.path.join(directory, name + ".log"), "w") as log:
+        status = subprocess.call(command, cwd=directory, env=env,
+                                 stdout=log, stderr=subprocess.STDOUT)
+    elapsed = time.time() - start
+    if status != 0:
+        print("  failed with status %d, see %s.log" % (status, name))
+        return None
+    with open(os.path.join(directory, name + "-profile.json")) as stream:
+        profile = json.load(stream)
+    sweeps, generations, memory = read_telemetry(
+        os.path.join(directory, name + "-telemetry.jsonl"))
+    return {"ranks": ranks, "threads": threads, "cells": cells,
+            "elapsed": elapsed, "times": phase_times(profile),
+            "sweeps": sweeps, "generations": generations, "memory": memory}
+
+
+def efficiency(mode, base, result, phase):
+    t0, t = base["times"][phase], result["times"][phase]
+    if t0 <= 0.0 or t <= 0.0:
+        return float("nan"), float("nan")
+    workers0 = base["ranks"] * base["threads"]
+    workers = result["ranks"] * result["threads"]
+    if mode == "strong":
+        speedup = t0 / t
+        return speedup, speedup * workers0 / workers
+    # weak: time per unit of work per worker
+    w0, w = base["cells"] / float(workers0), result["cells"] / float(workers)
+    return float("nan"), (t0 / w0) / (t / w)
+
+
+def write_tables(args, results):
+    base = results[0]
+    header = ["ranks", "threads", "cells", "sweeps", "hwm MB/rank"]
+    rows = []
+    for r in results:
+        row = [r["ranks"], r["threads"], r["cells"], r["sweeps"], "%.0f" % r["memory"]]
+        for phase in PHASES:
+            speedup, eff = efficiency(args.mode, base, r, phase)
+            row += ["%.3f" % r["times"][phase], ("%.2f" % eff) if eff == eff else "-"]
+        rows.append(row)
+    for phase in PHASES:
+        header += [phase + " [s]", "eff"]
+
+    markdown = ["| " + " | ".join(header) + " |",
+                "|" + "---|" * len(header)]
+    markdown += ["| " + " | ".join(str(v) for v in row) + " |" for row in rows]
+
+    # the phase whose efficiency first drops below the threshold
+    verdict = "all phases stay above %.0f%% efficiency" % (100 * EFFICIENCY_THRESHOLD)
+    for r in results[1:]:
+        worst = None
+        for phase in PHASES[:-1]:
+            eff = efficiency(args.mode, base, r, phase)[1]
+            if eff == eff and eff < EFFICIENCY_THRESHOLD and (worst is None or eff < worst[1]):
+                worst = (phase, eff)
+        if worst:
+            verdict = "%s stops scaling first: %.0f%% efficiency at %d ranks x %d threads" % (
+                worst[0], 100 * worst[1], r["ranks"], r["threads"])
+            break
+    markdown += ["", verdict]
+
+    text = "\n".join(markdown)
+    with open(os.path.join(args.workdir, args.mode + "-scaling.md"), "w") as out:
+        out.write(text + "\n")
+    with open(os.path.join(args.workdir, args.mode + "-scaling.csv"), "w") as out:
+        writer = csv.writer(out)
+        writer.writerow(header)
+        writer.writerows(rows)
+    print(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--mode", choices=("strong", "weak"), default="strong")
+    parser.add_argument("--ranks", type=int_list, default=[1, 2, 4, 8])
+    parser.add_argument("--threads", type=int_list, default=[1])
+    parser.add_argument("--xtrans", default="xtrans", help="path of the xtrans executable")
+    parser.add_argument("--launcher", default="mpirun -np {ranks}",
+                        help="command prefix; {ranks} and {threads} are substituted")
+    parser.add_argument("--workdir", default="scaling-runs")
+    parser.add_argument("--dry-run", action="store_true", help="write inputs and print commands only")
+    parser.add_argument("--dim", type=int, default=2, choices=(2, 3))
+    parser.add_argument("--assemblies", type=int, default=2)
+    parser.add_argument("--layers", type=int, default=4)
+    parser.add_argument("--groups", type=int, default=7)
+    parser.add_argument("--sn", type=int, default=8)
+    parser.add_argument("--fe-order", type=int, default=1)
+    parser.add_argument("--discretization", default="dfem", choices=("dfem", "cfem"))
+    parser.add_argument("--refinements", type=int, default=1)
+    parser.add_argument("--solver", default="cg")
+    parser.add_argument("--preconditioner", default="amg")
+    parser.add_argument("--load-balancing", default="cost model")
+    args = parser.parse_args()
+    args.ranks = sorted(args.ranks)
+
+    results = []
+    for ranks in args.ranks:
+        for threads in args.threads:
+            result = run_case(args, ranks, threads)
+            if result:
+                results.append(result)
+    if results:
+        write_tables(args, results)
+
+
+if __name__ == "__main__":
+    main()
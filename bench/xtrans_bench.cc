@@ -0,0 +1,579 @@
+/* ---------------------------------------------------------------------
+ *
+ * Microbenchmarks of the even-parity assembly and source kernels.
+ *
+ * Every case sets up an EvenParity model on a synthetic hyper-rectangle
+ * with one material and a flat source, then times each kernel in isolation
+ * over all local cells (or faces) and all components. The best of
+ * --repeat passes is reported. FLOP and byte counts are models of the
+ * inner loops, not hardware counter readings: byte counts assume the
+ * operands stream from memory once per call.
+ *
+ * With --profile the rates summed over all cases, the node size and the
+ * MPI_Allreduce latency are written as a machine profile for the "plan
+ * only" mode of xtrans. Calibrate on a full node with the discretization
+ * of the jobs to be planned.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/utilities.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/common/machine_profile.h"
+#include "../include/common/problem_definition.h"
+#include "../include/transport/base/transport_base.h"
+#include "../include/transport/derived/even_parity.h"
+
+using namespace dealii;
+
+namespace
+{
+  struct BenchOptions
+  {
+    std::vector<unsigned int> dims;
+    std::vector<unsigned int> fe_orders;
+    std::vector<unsigned int> sn_orders;
+    std::vector<unsigned int> groups;
+    std::string discretization;
+    unsigned int n_cells;
+    unsigned int repeat;
+    std::string profile_filename;
+  };
+
+  // one row of the report
+  struct KernelTiming
+  {
+    std::string name;
+    double calls;
+    double seconds;
+    double n_cells;
+    double flops;
+    double bytes;
+  };
+
+  std::vector<unsigned int> parse_list (const std::string &list)
+  {
+    std::vector<unsigned int> values;
+    std::vector<std::string> strings = Utilities::split_string_list (list);
+    for (unsigned int i=0; i<strings.size(); ++i)
+      values.push_back (Utilities::string_to_int (strings[i]));
+    return values;
+  }
+
+  void print_usage ()
+  {
+    std::cerr
+    << "Call the program as mpirun -np num_proc xtrans-bench [options]" << std::endl
+    << "  --dims 2,3              problem dimensions" << std::endl
+    << "  --fe-orders 1,2         finite element degrees" << std::endl
+    << "  --sn-orders 4,8         angular quadrature orders (lsgc)" << std::endl
+    << "  --groups 1,4            numbers of groups" << std::endl
+    << "  --discretization dfem   dfem or cfem" << std::endl
+    << "  --cells 8               cells per direction of the synthetic mesh" << std::endl
+    << "  --repeat 3              passes per kernel, the fastest is reported" << std::endl
+    << "  --profile file          write a machine profile for xtrans plan only runs" << std::endl;
+  }
+
+  // input of one case: a unit box with n_cells cells per direction, one
+  // material with sigma_t = 1, sigma_s = 0.5 (group-diagonal) and Q = 1
+  void set_case_parameters (ParameterHandler &prm,
+                            const BenchOptions &options,
+                            unsigned int dim,
+                            unsigned int fe_order,
+                            unsigned int sn_order,
+                            unsigned int n_group,
+                            const std::string &mid_filename)
+  {
+    std::ostringstream cells, group_ones;
+    for (unsigned int d=0; d<3; ++d)
+      cells << (d==0 ? "" : ", ") << options.n_cells;
+    for (unsigned int g=0; g<n_group; ++g)
+      group_ones << (g==0 ? "" : ", ") << "1.0";
+
+    prm.set ("problem dimension", Utilities::int_to_string (dim));
+    prm.set ("transport model", "ep");
+    prm.set ("spatial discretization", options.discretization);
+    prm.set ("finite element polynomial degree", Utilities::int_to_string (fe_order));
+    prm.set ("angular quadrature name", "lsgc");
+    prm.set ("angular quadrature order", Utilities::int_to_string (sn_order));
+    prm.set ("number of groups", Utilities::int_to_string (n_group));
+    prm.set ("number of materials", "1");
+    prm.set ("do print angular quadrature info", "false");
+    prm.set ("x, y, z max values of boundary locations", "1.0, 1.0, 1.0");
+    prm.set ("number of cells for x, y, z directions", cells.str ());
+    prm.set ("output format", "none");
+    prm.enter_subsection ("material ID map");
+    prm.set ("material id file name", mid_filename);
+    prm.leave_subsection ();
+    if (n_group==1)
+    {
+      prm.enter_subsection ("one-group sigma_t");
+      prm.set ("values", "1.0");
+      prm.leave_subsection ();
+      prm.enter_subsection ("one-group sigma_s");
+      prm.set ("values", "0.5");
+      prm.leave_subsection ();
+      prm.enter_subsection ("one-group Q");
+      prm.set ("values", "1.0");
+      prm.leave_subsection ();
+    }
+    else
+    {
+      prm.enter_subsection ("sigma_t, group=1 to G");
+      prm.set ("material 1", group_ones.str ());
+      prm.leave_subsection ();
+      prm.enter_subsection ("sigma_s, material 1");
+      for (unsigned int gin=0; gin<n_group; ++gin)
+      {
+        std::ostringstream row;
+        for (unsigned int g=0; g<n_group; ++g)
+          row << (g==0 ? "" : ", ") << (g==gin ? "0.5" : "0.0");
+        prm.set ("g_in=" + Utilities::int_to_string (gin+1), row.str ());
+      }
+      prm.leave_subsection ();
+      prm.enter_subsection ("Q, group=1 to G");
+      prm.set ("material 1", group_ones.str ());
+      prm.leave_subsection ();
+    }
+  }
+}
+
+// Exposes the kernels of EvenParity together with the cell and face data
+// the assembly feeds them.
+template <int dim>
+class KernelBench : public EvenParity<dim>
+{
+public:
+  KernelBench (ParameterHandler &prm);
+
+  void run_kernels (unsigned int repeat,
+                    std::vector<KernelTiming> &timings);
+
+private:
+  double time_pre_assembly ();
+  double time_cell_bilinear_form ();
+  double time_boundary_bilinear_form ();
+  double time_interface_bilinear_form ();
+  double time_ho_rhs ();
+  double time_moments ();
+  double time_matrix_vector ();
+
+  const bool is_dfem;
+  std::vector<std::vector<FullMatrix<double> > > streaming_at_qp;
+  std::vector<FullMatrix<double> > collision_at_qp;
+};
+
+template <int dim>
+KernelBench<dim>::KernelBench (ParameterHandler &prm)
+:
+EvenParity<dim> (prm),
+is_dfem (prm.get ("spatial discretization")=="dfem")
+{
+}
+
+template <int dim>
+double KernelBench<dim>::time_pre_assembly ()
+{
+  const double t0 = MPI_Wtime ();
+  for (unsigned int ic=0; ic<this->local_cells.size(); ++ic)
+  {
+    this->fv->reinit (this->local_cells[ic]);
+    this->pre_assemble_cell_matrices (this->fv, this->local_cells[ic],
+                                      streaming_at_qp, collision_at_qp);
+  }
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_cell_bilinear_form ()
+{
+  FullMatrix<double> local_mat (this->dofs_per_cell, this->dofs_per_cell);
+  const double t0 = MPI_Wtime ();
+  for (unsigned int k=0; k<this->n_total_ho_vars; ++k)
+  {
+    unsigned int g = this->get_component_group (k);
+    unsigned int i_dir = this->get_component_direction (k);
+    for (unsigned int ic=0; ic<this->local_cells.size(); ++ic)
+    {
+      local_mat = 0;
+      this->integrate_cell_bilinear_form (ic, local_mat, i_dir, g,
+                                          streaming_at_qp, collision_at_qp);
+    }
+  }
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_boundary_bilinear_form ()
+{
+  FullMatrix<double> local_mat (this->dofs_per_cell, this->dofs_per_cell);
+  const double t0 = MPI_Wtime ();
+  for (unsigned int k=0; k<this->n_total_ho_vars; ++k)
+  {
+    unsigned int g = this->get_component_group (k);
+    unsigned int i_dir = this->get_component_direction (k);
+    for (unsigned int i=0; i<this->vacuum_faces.size(); ++i)
+    {
+      unsigned int ic = this->vacuum_faces[i].first;
+      unsigned int fn = this->vacuum_faces[i].second;
+      this->fvf->reinit (this->local_cells[ic], fn);
+      local_mat = 0;
+      this->integrate_boundary_bilinear_form (this->fvf, ic, fn, local_mat, i_dir, g);
+    }
+  }
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_interface_bilinear_form ()
+{
+  FullMatrix<double> vp_up (this->dofs_per_cell, this->dofs_per_cell);
+  FullMatrix<double> vp_un (this->dofs_per_cell, this->dofs_per_cell);
+  FullMatrix<double> vn_up (this->dofs_per_cell, this->dofs_per_cell);
+  FullMatrix<double> vn_un (this->dofs_per_cell, this->dofs_per_cell);
+  const double t0 = MPI_Wtime ();
+  for (unsigned int k=0; k<this->n_total_ho_vars; ++k)
+  {
+    unsigned int g = this->get_component_group (k);
+    unsigned int i_dir = this->get_component_direction (k);
+    for (unsigned int i_face=0; i_face<this->interior_faces.size(); ++i_face)
+    {
+      unsigned int ic = this->interior_faces[i_face].first;
+      unsigned int fn = this->interior_faces[i_face].second;
+      this->fvf->reinit (this->local_cells[ic], fn);
+      std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fv_nei =
+      this->reinit_neighbor_face_values (i_face);
+      vp_up = 0;
+      vp_un = 0;
+      vn_up = 0;
+      vn_un = 0;
+      this->integrate_interface_bilinear_form (this->fvf, fv_nei, ic, fn, i_dir, g,
+                                               vp_up, vp_un, vn_up, vn_un);
+    }
+  }
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_ho_rhs ()
+{
+  MPI_Barrier (this->mpi_communicator);
+  const double t0 = MPI_Wtime ();
+  this->generate_ho_rhs ();
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_moments ()
+{
+  MPI_Barrier (this->mpi_communicator);
+  const double t0 = MPI_Wtime ();
+  this->generate_moments ();
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+double KernelBench<dim>::time_matrix_vector ()
+{
+  MPI_Barrier (this->mpi_communicator);
+  const double t0 = MPI_Wtime ();
+  for (unsigned int k=0; k<this->n_total_ho_vars; ++k)
+    this->vec_ho_sys[k]->vmult (*this->vec_ho_rhs[k], *this->vec_aflx[k]);
+  return MPI_Wtime () - t0;
+}
+
+template <int dim>
+void KernelBench<dim>::run_kernels (unsigned int repeat,
+                                    std::vector<KernelTiming> &timings)
+{
+  this->setup ();
+  streaming_at_qp.assign (this->n_q, std::vector<FullMatrix<double> >
+                          (this->n_dir, FullMatrix<double> (this->dofs_per_cell,
+                                                            this->dofs_per_cell)));
+  collision_at_qp.assign (this->n_q, FullMatrix<double> (this->dofs_per_cell,
+                                                         this->dofs_per_cell));
+  // the right-hand side reads the fixed source and the scalar fluxes
+  this->generate_ho_fixed_source ();
+  this->generate_moments ();
+
+  const double n_cells = this->local_cells.size ();
+  const double n_comp = this->n_total_ho_vars;
+  const double d = this->dofs_per_cell;
+  const double n_q = this->n_q;
+  const double n_qf = this->n_qf;
+  const double n_vacuum = this->vacuum_faces.size ();
+  const double n_interior = this->interior_faces.size ();
+  const double n_local_dofs = this->local_dofs.n_elements ();
+  const double n_group = this->n_group;
+  // local share of the nonzeros of one HO matrix
+  const double n_local_nnz = (this->vec_ho_sys[0]->n_nonzero_elements () /
+                              static_cast<double>(Utilities::MPI::n_mpi_processes (this->mpi_communicator)));
+
+  std::vector<double> best (7, std::numeric_limits<double>::max ());
+  for (unsigned int r=0; r<repeat; ++r)
+  {
+    best[0] = std::min (best[0], time_pre_assembly ());
+    best[1] = std::min (best[1], time_cell_bilinear_form ());
+    best[2] = std::min (best[2], time_boundary_bilinear_form ());
+    if (is_dfem)
+      best[3] = std::min (best[3], time_interface_bilinear_form ());
+    best[4] = std::min (best[4], time_ho_rhs ());
+    best[5] = std::min (best[5], time_moments ());
+    best[6] = std::min (best[6], time_matrix_vector ());
+  }
+
+  // Models per call. pre-assembly: n_dir streaming and one collision matrix
+  // per quadrature point, 2 dot products of length dim per entry; cell:
+  // (s*a + c*b)*w accumulated per entry and point; boundary: v*v*w
+  // accumulated; interface: four blocks of two directional terms; rhs: the
+  // group sum per point, the test-function update and the per-component
+  // copies; moments: one axpy per component; matrix-vector: AIJ values and
+  // column indices once, source and result vectors.
+  KernelTiming rows[7] =
+  {
+    {"pre_assemble_cell_matrices", n_cells, best[0], n_cells,
+     n_cells * n_q * (this->n_dir * d * d * (4.0 * dim - 1.0) + d * d),
+     8.0 * n_cells * n_q * (this->n_dir + 1.0) * d * d},
+    {"integrate_cell_bilinear_form", n_cells * n_comp, best[1], n_cells,
+     n_cells * n_comp * n_q * d * d * 5.0,
+     8.0 * n_cells * n_comp * (2.0 * n_q * d * d + d * d)},
+    {"integrate_boundary_bilinear_form", n_vacuum * n_comp, best[2], n_cells,
+     n_vacuum * n_comp * n_qf * d * d * 3.0,
+     8.0 * n_vacuum * n_comp * (n_qf * d + d * d)},
+    {"integrate_interface_bilinear_form", n_interior * n_comp, best[3], n_cells,
+     n_interior * n_comp * n_qf * d * d * 4.0 * 8.0,
+     8.0 * n_interior * n_comp * (4.0 * d * d + 4.0 * n_qf * d * (dim + 1.0))},
+    {"generate_ho_rhs", 1.0, best[4], n_cells,
+     n_group * n_cells * n_q * (2.0 * n_group + 2.0 * d),
+     8.0 * (n_group * n_cells * (n_group * d + n_q * d) + 2.0 * n_comp * n_local_dofs)},
+    {"generate_moments", 1.0, best[5], n_cells,
+     2.0 * n_comp * n_local_dofs,
+     8.0 * n_local_dofs * (2.0 * n_comp + 3.0 * n_group)},
+    {"ho_matrix_vector", n_comp, best[6], n_cells,
+     2.0 * n_comp * n_local_nnz,
+     n_comp * (12.0 * n_local_nnz + 16.0 * n_local_dofs)}
+  };
+  for (unsigned int i=0; i<7; ++i)
+    if (i!=3 || is_dfem)
+    {
+      // the slowest processor sets the time, work adds up over processors
+      rows[i].seconds = Utilities::MPI::max (rows[i].seconds, this->mpi_communicator);
+      rows[i].calls = Utilities::MPI::sum (rows[i].calls, this->mpi_communicator);
+      rows[i].n_cells = Utilities::MPI::sum (rows[i].n_cells, this->mpi_communicator);
+      rows[i].flops = Utilities::MPI::sum (rows[i].flops, this->mpi_communicator);
+      rows[i].bytes = Utilities::MPI::sum (rows[i].bytes, this->mpi_communicator);
+      timings.push_back (rows[i]);
+    }
+}
+
+template <int dim>
+void run_case (ParameterHandler &prm,
+               unsigned int repeat,
+               std::vector<KernelTiming> &timings)
+{
+  KernelBench<dim> bench (prm);
+  bench.run_kernels (repeat, timings);
+}
+
+int main (int argc, char *argv[])
+{
+  try
+  {
+    Utilities::MPI::MPI_InitFinalize mpi_initialization (argc, argv, 1);
+    const bool is_root = (Utilities::MPI::this_mpi_process (MPI_COMM_WORLD)==0);
+
+    BenchOptions options;
+    options.dims = parse_list ("2, 3");
+    options.fe_orders = parse_list ("1, 2");
+    options.sn_orders = parse_list ("4, 8");
+    options.groups = parse_list ("1, 4");
+    options.discretization = "dfem";
+    options.n_cells = 8;
+    options.repeat = 3;
+    for (int i=1; i<argc; ++i)
+    {
+      const std::string arg (argv[i]);
+      if (i+1>=argc)
+      {
+        if (is_root)
+          print_usage ();
+        return 1;
+      }
+      const std::string value (argv[++i]);
+      if (arg=="--dims")
+        options.dims = parse_list (value);
+      else if (arg=="--fe-orders")
+        options.fe_orders = parse_list (value);
+      else if (arg=="--sn-orders")
+        options.sn_orders = parse_list (value);
+      else if (arg=="--groups")
+        options.groups = parse_list (value);
+      else if (arg=="--discretization")
+        options.discretization = value;
+      else if (arg=="--cells")
+        options.n_cells = Utilities::string_to_int (value);
+      else if (arg=="--repeat")
+        options.repeat = std::max (1, Utilities::string_to_int (value));
+      else if (arg=="--profile")
+        options.profile_filename = value;
+      else
+      {
+        if (is_root)
+          print_usage ();
+        return 1;
+      }
+    }
+
+    // all cells belong to material 1
+    const std::string mid_filename = "xtrans-bench-mid.txt";
+    if (is_root)
+    {
+      std::ofstream mid (mid_filename.c_str ());
+      for (unsigned int i=0; i<options.n_cells*options.n_cells*options.n_cells; ++i)
+        mid << "1\n";
+    }
+    MPI_Barrier (MPI_COMM_WORLD);
+
+    // seconds and work of the assembly, stream and matrix-vector kernels
+    // over all cases
+    std::vector<double> profile_seconds (3, 0.0);
+    std::vector<double> profile_work (3, 0.0);
+
+    std::ostringstream report;
+    report << std::left
+    << std::setw(4) << "dim"
+    << std::setw(3) << "p"
+    << std::setw(4) << "SN"
+    << std::setw(4) << "G"
+    << std::setw(35) << "kernel"
+    << std::right
+    << std::setw(12) << "calls"
+    << std::setw(12) << "ns/call"
+    << std::setw(12) << "ns/cell"
+    << std::setw(10) << "GFLOP/s"
+    << std::setw(10) << "GB/s" << std::endl;
+
+    for (unsigned int a=0; a<options.dims.size(); ++a)
+      for (unsigned int b=0; b<options.fe_orders.size(); ++b)
+        for (unsigned int c=0; c<options.sn_orders.size(); ++c)
+          for (unsigned int e=0; e<options.groups.size(); ++e)
+          {
+            const unsigned int dim = options.dims[a];
+            AssertThrow (dim==2 || dim==3,
+                         ExcMessage("xtrans-bench runs 2D and 3D cases only"));
+            ParameterHandler prm;
+            ProblemDefinition::declare_parameters (prm);
+            set_case_parameters (prm, options, dim, options.fe_orders[b],
+                                 options.sn_orders[c], options.groups[e],
+                                 mid_filename);
+            std::vector<KernelTiming> timings;
+            if (dim==2)
+              run_case<2> (prm, options.repeat, timings);
+            else
+              run_case<3> (prm, options.repeat, timings);
+
+            for (unsigned int i=0; i<timings.size(); ++i)
+            {
+              const KernelTiming &t = timings[i];
+              report << std::left
+              << std::setw(4) << dim
+              << std::setw(3) << options.fe_orders[b]
+              << std::setw(4) << options.sn_orders[c]
+              << std::setw(4) << options.groups[e]
+              << std::setw(35) << t.name
+              << std::right << std::fixed
+              << std::setw(12) << std::setprecision(0) << t.calls
+              << std::setw(12) << std::setprecision(1) << 1.0e9 * t.seconds / std::max (1.0, t.calls)
+              << std::setw(12) << std::setprecision(1) << 1.0e9 * t.seconds / std::max (1.0, t.n_cells)
+              << std::setw(10) << std::setprecision(3) << 1.0e-9 * t.flops / t.seconds
+              << std::setw(10) << std::setprecision(3) << 1.0e-9 * t.bytes / t.seconds
+              << std::endl;
+              report.unsetf (std::ios_base::floatfield);
+
+              const unsigned int kind = (t.name=="ho_matrix_vector" ? 2 :
+                                         (t.name=="generate_ho_rhs" ||
+                                          t.name=="generate_moments") ? 1 : 0);
+              profile_seconds[kind] += t.seconds;
+              profile_work[kind] += (kind==0 ? t.flops : t.bytes);
+            }
+          }
+
+    if (options.profile_filename!="")
+    {
+      const double n_procs = Utilities::MPI::n_mpi_processes (MPI_COMM_WORLD);
+      MachineProfile profile;
+      profile.calibration_processes = n_procs;
+      profile.cores_per_node = std::max (1u, std::thread::hardware_concurrency ());
+      {
+        // MemTotal in kB
+        std::ifstream meminfo ("/proc/meminfo");
+        std::string line;
+        while (std::getline (meminfo, line))
+          if (line.compare (0, 9, "MemTotal:")==0)
+          {
+            profile.memory_per_node_mb = std::atof (line.c_str () + 9) / 1024.0;
+            break;
+          }
+      }
+      profile.assembly_gflops = 1.0e-9 * profile_work[0] / profile_seconds[0] / n_procs;
+      profile.stream_gbs = 1.0e-9 * profile_work[1] / profile_seconds[1] / n_procs;
+      profile.matrix_vector_gbs = 1.0e-9 * profile_work[2] / profile_seconds[2] / n_procs;
+      {
+        const unsigned int n_reductions = 1000;
+        double value = 1.0;
+        MPI_Barrier (MPI_COMM_WORLD);
+        const double t0 = MPI_Wtime ();
+        for (unsigned int i=0; i<n_reductions; ++i)
+          value = Utilities::MPI::sum (value, MPI_COMM_WORLD) / n_procs;
+        profile.allreduce_latency =
+        Utilities::MPI::max ((MPI_Wtime () - t0) / n_reductions, MPI_COMM_WORLD);
+      }
+      if (is_root)
+        profile.write (options.profile_filename);
+    }
+
+    if (is_root)
+    {
+      std::cout << std::endl << report.str ();
+      std::remove (mid_filename.c_str ());
+    }
+  }
+  catch (std::exception &exc)
+  {
+    std::cerr << std::endl << std::endl
+    << "----------------------------------------------------"
+    << std::endl;
+    std::cerr << "Exception on processing: " << std::endl
+    << exc.what() << std::endl
+    << "Aborting!" << std::endl
+    << "----------------------------------------------------"
+    << std::endl;
+    return 1;
+  }
+  catch (...)
+  {
+    std::cerr << std::endl << std::endl
+    << "----------------------------------------------------"
+    << std::endl;
+    std::cerr << "Unknown exception!" << std::endl
+    << "Aborting!" << std::endl
+    << "----------------------------------------------------"
+    << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef __aq_factory_h__
+#define __aq_factory_h__
+
+#include <deal.II/base/std_cxx11/shared_ptr.h>
+
+#include "base/aq_base.h"
+
+// Names accepted by "angular quadrature name", in the form of a
+// Patterns::Selection string. Adding a set means adding it here and to
+// build_aq_model.
+std::string get_aq_names ();
+
+// Creates the AQBase implementation named by "angular quadrature name".
+// make_aq still has to be called on the result.
+template <int dim>
+std_cxx11::shared_ptr<AQBase<dim> > build_aq_model (ParameterHandler &prm);
+
+#endif //__aq_factory_h__
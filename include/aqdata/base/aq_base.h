@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <string>
 
+#include "component_layout.h"
+
 using namespace dealii;
 
 template <int dim>
@@ -21,8 +23,11 @@ public:
   virtual void produce_angular_quad ();
   virtual void initialize_component_index ();
   void print_angular_quad ();
+  std::string produce_accuracy_summary ();
   
   void make_aq (ParameterHandler &prm);
+  // overrides "angular quadrature order"; call before make_aq
+  void set_sn_order (unsigned int order);
 
   unsigned int get_sn_order ();
   unsigned int get_n_dir ();
@@ -30,10 +35,7 @@ public:
   std::vector<double> get_angular_weights ();
   std::vector<double> get_tensor_norms ();
   std::vector<Tensor<1, dim> > get_all_directions ();
-  std::map<std::pair<unsigned int, unsigned int>, unsigned int>
-  get_component_index_map ();
-  std::unordered_map<unsigned int, std::pair<unsigned int, unsigned int> >
-  get_inv_component_map ();
+  ComponentLayout get_component_layout ();
   std::map<std::pair<unsigned int, unsigned int>, unsigned int>
   get_reflective_direction_index_map ();
 
@@ -44,23 +46,30 @@ protected:
   bool have_reflective_bc;
   std::string transport_model_name;
   std::string discretization;
+  std::string component_ordering;
   unsigned int n_azi;
   unsigned int n_group;
   unsigned int n_dir;
   unsigned int n_total_ho_vars;
+  // Stores a symmetric full-sphere set (weights summing to 4 pi) the way
+  // LSGC does: only one direction per class of images that the problem
+  // cannot tell apart (z -> -z in 2D, omega -> -omega for EP), with the
+  // weights of the dropped images folded onto it.
+  void fold_full_sphere_set (const std::vector<Tensor<1, 3> > &directions,
+                             const std::vector<double> &weights);
+  void finalize_angular_quad ();
+
   std::vector<Tensor<1, dim> > omega_i;
   std::vector<double> wi;
   std::vector<double> tensor_norms;
-  std::map<std::pair<unsigned int, unsigned int>, unsigned int>
-  component_index;
-  std::unordered_map<unsigned int, std::pair<unsigned int, unsigned int> >
-  inverse_component_index;
+  ComponentLayout component_layout;
   std::map<std::pair<unsigned int, unsigned int>, unsigned int>
   reflective_direction_index;
 
 private:
   std::string produce_quadrature_name ();
   void initialize_ref_bc_index ();
+  std::vector<long long> get_direction_key (const Tensor<1, dim> &omega);
 
   std::string aq_name;
 };
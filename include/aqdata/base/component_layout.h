@@ -0,0 +1,84 @@
+#ifndef __component_layout_h__
+#define __component_layout_h__
+
+#include <string>
+#include <vector>
+
+// Maps (direction, group) pairs to HO component indices and back with plain
+// arithmetic. Two orderings are supported:
+//   "direction-major": k = i_dir * n_group + g (groups of one direction are adjacent)
+//   "group-major":     k = g * n_dir + i_dir   (directions of one group are adjacent)
+// With per-group angular orders, directions index a catalog holding every
+// group's set and group g owns directions [first_direction(g),
+// end_direction(g)). Components are then group-major and looked up in tables.
+// Components added with add_components (the coarse angular multigrid levels)
+// follow all of these and always use the tables.
+// The accessors are defined inline since they sit inside assembly, RHS and
+// moment loops.
+class ComponentLayout
+{
+public:
+  ComponentLayout ();
+  ComponentLayout (unsigned int n_dir,
+                   unsigned int n_group,
+                   std::string ordering);
+  ComponentLayout (const std::vector<unsigned int> &group_first_direction,
+                   const std::vector<unsigned int> &group_n_dir);
+  ~ComponentLayout ();
+  
+  unsigned int index (unsigned int i_dir, unsigned int g) const
+  {
+    if (!is_uniform)
+      return group_offset[g] + i_dir - group_first_direction[g];
+    return (is_group_major ? g * n_dir + i_dir : i_dir * n_group + g);
+  }
+  
+  unsigned int direction (unsigned int k) const
+  {
+    if (!is_uniform || k>=n_base)
+      return component_direction[k];
+    return (is_group_major ? k % n_dir : k / n_group);
+  }
+  
+  unsigned int group (unsigned int k) const
+  {
+    if (!is_uniform || k>=n_base)
+      return component_group[k];
+    return (is_group_major ? k / n_dir : k % n_group);
+  }
+  
+  unsigned int first_direction (unsigned int g) const
+  {
+    return (is_uniform ? 0 : group_first_direction[g]);
+  }
+  
+  unsigned int end_direction (unsigned int g) const
+  {
+    return (is_uniform ? n_dir :
+            group_first_direction[g] + group_offset[g+1] - group_offset[g]);
+  }
+  
+  // appends n components of group g with directions first_direction,
+  // first_direction+1, ...; returns the index of the first one
+  unsigned int add_components (unsigned int first_direction,
+                               unsigned int n,
+                               unsigned int g);
+  
+  // components of the layout itself, without added ones
+  unsigned int get_n_components () const;
+  unsigned int get_n_added_components () const;
+  std::string get_ordering () const;
+  
+private:
+  bool is_group_major;
+  bool is_uniform;
+  unsigned int n_base;
+  unsigned int n_dir;
+  unsigned int n_group;
+  std::vector<unsigned int> group_first_direction;
+  std::vector<unsigned int> group_offset;
+  std::vector<unsigned int> component_direction;
+  std::vector<unsigned int> component_group;
+};
+
+#endif //__component_layout_h__
@@ -0,0 +1,18 @@
+#ifndef __aq_lebedev_h__
+#define __aq_lebedev_h__
+
+#include "../base/aq_base.h"
+
+using namespace dealii;
+
+template <int dim>
+class AQLebedev : public AQBase<dim>
+{
+public:
+  AQLebedev (ParameterHandler &prm);
+  ~AQLebedev ();
+  
+  void produce_angular_quad ();
+};
+
+#endif//__aq_lebedev_h__
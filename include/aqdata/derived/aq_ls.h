@@ -0,0 +1,18 @@
+#ifndef __aq_ls_h__
+#define __aq_ls_h__
+
+#include "../base/aq_base.h"
+
+using namespace dealii;
+
+template <int dim>
+class AQLS : public AQBase<dim>
+{
+public:
+  AQLS (ParameterHandler &prm);
+  ~AQLS ();
+  
+  void produce_angular_quad ();
+};
+
+#endif//__aq_ls_h__
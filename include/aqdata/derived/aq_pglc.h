@@ -0,0 +1,18 @@
+#ifndef __aq_pglc_h__
+#define __aq_pglc_h__
+
+#include "../base/aq_base.h"
+
+using namespace dealii;
+
+template <int dim>
+class AQPGLC : public AQBase<dim>
+{
+public:
+  AQPGLC (ParameterHandler &prm);
+  ~AQPGLC ();
+  
+  void produce_angular_quad ();
+};
+
+#endif//__aq_pglc_h__
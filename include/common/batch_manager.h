@@ -0,0 +1,53 @@
+#ifndef __BATCH_MANAGER__H__
+#define __BATCH_MANAGER__H__
+
+#include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/std_cxx11/shared_ptr.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace dealii;
+
+// Runs a list of cases in one process launch. Each line of the case list is
+//
+//   input_file [| subsection::...::entry = value]...
+//
+// where the optional overrides are applied on top of the input file. Lines
+// starting with '#' are ignored. Cases agreeing on all mesh, finite element,
+// quadrature and solver parameters form a group: the first case of a group
+// is set up from scratch, the others only swap cross sections on the same
+// model and warm-start from the previous solution; other parameters of
+// those cases that differ from the first one are reported as ignored. A
+// summary table is written to <case list>.summary.
+class BatchManager
+{
+public:
+  BatchManager (const std::string &case_list_name);
+  ~BatchManager ();
+  
+  void run ();
+  
+private:
+  void read_case_list ();
+  std::string get_setup_key (ParameterHandler &prm);
+  std::map<std::string, std::string> get_top_level_entries (ParameterHandler &prm);
+  void warn_ignored_parameters (unsigned int first_case, unsigned int c);
+  void write_summary ();
+  
+  template <int dim>
+  void run_group (const std::vector<unsigned int> &group_cases);
+  
+  std::string case_list_name;
+  
+  std::vector<std::string> case_descriptions;
+  std::vector<std_cxx11::shared_ptr<ParameterHandler> > case_prms;
+  std::vector<unsigned int> case_groups;
+  std::vector<bool> is_case_eigen;
+  std::vector<double> case_keffs;
+  std::vector<double> case_wall_times;
+  std::vector<bool> is_case_setup;
+};
+
+#endif //__BATCH_MANAGER__H__
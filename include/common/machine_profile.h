@@ -0,0 +1,42 @@
+#ifndef __MACHINE_PROFILE__H__
+#define __MACHINE_PROFILE__H__
+
+#include <deal.II/base/parameter_handler.h>
+
+#include <string>
+
+using namespace dealii;
+
+// Node size and per-processor rates of a machine, written by
+// xtrans-bench --profile and read by the "plan only" mode. Rates hold for
+// one MPI processor while the number of processors of the calibration run
+// share the node, so the calibration should fill a node.
+class MachineProfile
+{
+public:
+  MachineProfile ();
+  ~MachineProfile ();
+
+  // an empty file name keeps the defaults of an uncalibrated node
+  void read (const std::string &filename);
+  void write (const std::string &filename) const;
+  bool is_calibrated () const;
+
+  unsigned int calibration_processes;
+  unsigned int cores_per_node;
+  double memory_per_node_mb;
+  // local assembly kernels
+  double assembly_gflops;
+  // scattering source and moment kernels
+  double stream_gbs;
+  // HO matrix-vector products
+  double matrix_vector_gbs;
+  // latency of an MPI_Allreduce of one double at the calibration size
+  double allreduce_latency;
+
+private:
+  static void declare_parameters (ParameterHandler &prm);
+  bool calibrated;
+};
+
+#endif //__MACHINE_PROFILE__H__
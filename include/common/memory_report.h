@@ -0,0 +1,36 @@
+#ifndef __MEMORY_REPORT__H__
+#define __MEMORY_REPORT__H__
+
+#include <deal.II/base/mpi.h>
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dealii;
+
+// Memory table of named structures. Every processor adds the bytes it holds
+// for each structure, in the same order on all processors; print () reduces
+// every row and the per-processor sum to min/avg/max over processors plus
+// the total, in MB.
+class MemoryReport
+{
+public:
+  MemoryReport (MPI_Comm mpi_communicator, const std::string &title);
+  ~MemoryReport ();
+
+  void add (const std::string &name, double bytes);
+  // sum of the rows on this processor
+  double get_local_bytes () const;
+
+  // collective over the communicator; rank 0 writes the table to out
+  void print (std::ostream &out) const;
+
+private:
+  MPI_Comm mpi_communicator;
+  std::string title;
+  std::vector<std::pair<std::string, double> > rows;
+};
+
+#endif //__MEMORY_REPORT__H__
@@ -18,6 +18,8 @@ public:
 
 private:
   unsigned int dim;
+  bool is_dry_run;
+  bool is_plan_only;
   std::string transport_model_name;
   std::map<std::string, unsigned int> method_index;
 };
@@ -38,6 +38,7 @@ public:
   bool get_nda_bool ();
   bool get_eigen_problem_bool ();
   bool get_reflective_bool ();
+  bool get_explicit_reflective_bool ();
   bool get_print_sn_quad_bool ();
   bool get_generated_mesh_bool ();
   unsigned int get_sn_order ();
@@ -0,0 +1,64 @@
+#ifndef __PROFILER__H__
+#define __PROFILER__H__
+
+#include <deal.II/base/mpi.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dealii;
+
+// Nested wall-clock sections plus per-component HO solve times. Sections
+// are named by their path ("run/solve/source_iteration/ho_solve") and hold
+// call counts and accumulated time of this processor; write_json () reduces
+// them to min/max/avg over processors. When disabled, Scope and
+// add_component_solve return immediately.
+class Profiler
+{
+public:
+  Profiler (MPI_Comm mpi_communicator, bool enabled);
+  ~Profiler ();
+
+  // Times the enclosing block as a child section of the innermost open one
+  class Scope
+  {
+  public:
+    Scope (Profiler &profiler, const char *name);
+    ~Scope ();
+
+  private:
+    Profiler &profiler;
+    const bool active;
+  };
+
+  bool is_enabled () const;
+  void enter (const std::string &name);
+  void leave ();
+  void add_component_solve (unsigned int k, double wall_time, unsigned int iterations);
+
+  // collective over the communicator; rank 0 writes the file
+  void write_json (const std::string &filename);
+
+private:
+  struct Section
+  {
+    Section ();
+    unsigned long calls;
+    double wall_time;
+  };
+
+  std::vector<std::string> get_global_section_names ();
+
+  MPI_Comm mpi_communicator;
+  const bool enabled;
+
+  // open sections: path and start time
+  std::vector<std::pair<std::string, double> > open_sections;
+  std::map<std::string, Section> sections;
+  std::vector<Section> component_solves;
+  std::vector<unsigned long> component_iterations;
+};
+
+#endif //__PROFILER__H__
@@ -0,0 +1,75 @@
+#ifndef __TELEMETRY_STREAM__H__
+#define __TELEMETRY_STREAM__H__
+
+#include <deal.II/base/mpi.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace dealii;
+
+// JSON-lines stream of convergence and solver records, one object per line,
+// written by rank 0 and flushed after every record so it can be followed
+// while the run goes on. Schema "xtrans-telemetry/1", keys in this order:
+//
+//   schema        "xtrans-telemetry/1"
+//   event         "si" after every source iteration sweep,
+//                 "pi" after every power iteration generation
+//   wall_time     seconds since the stream was opened
+//   generation    power iteration generation, 0 for fixed-source problems
+//   iteration     source iteration within the generation ("si"), number of
+//                 source iterations the generation took ("pi")
+//   err_phi       relative l1 change of the scalar flux; against the
+//                 previous sweep ("si") or generation ("pi")
+//   spectral_radius  err_phi ratio of consecutive sweeps ("si" only)
+//   keff, err_k   eigenvalue and its relative change ("pi" only)
+//   linear_iterations, linear_times, linear_residuals
+//                 per HO system of the last sweep, fine components first and
+//                 angular multigrid levels after them ("si" only); the
+//                 iteration and residual arrays are empty with the direct
+//                 solver
+//   memory_hwm_mb_max, memory_hwm_mb_total
+//                 resident memory high-water mark (VmHWM) in MB, maximum
+//                 and sum over processors
+//
+// Non-finite numbers are written as null. An empty file name disables the
+// stream; the collective memory reduction is then skipped as well.
+class TelemetryStream
+{
+public:
+  // Accumulates the members of one record
+  class Record
+  {
+  public:
+    Record ();
+    void add (const std::string &key, const std::string &value);
+    void add (const std::string &key, double value);
+    void add (const std::string &key, unsigned int value);
+    void add (const std::string &key, const std::vector<double> &values);
+    void add (const std::string &key, const std::vector<unsigned int> &values);
+    std::string str () const;
+
+  private:
+    void add_key (const std::string &key);
+    static std::string format_number (double value);
+    std::string text;
+  };
+
+  TelemetryStream (MPI_Comm mpi_communicator, const std::string &filename);
+  ~TelemetryStream ();
+
+  bool is_enabled () const;
+  // starts a record with the schema, event and wall_time keys
+  Record begin_record (const std::string &event);
+  // adds the memory keys (collective) and writes the record
+  void write_record (Record &record);
+
+private:
+  MPI_Comm mpi_communicator;
+  const bool enabled;
+  const double start_time;
+  std::ofstream out;
+};
+
+#endif //__TELEMETRY_STREAM__H__
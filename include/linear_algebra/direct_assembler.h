@@ -0,0 +1,56 @@
+#ifndef __direct_assembler_h__
+#define __direct_assembler_h__
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/petsc_parallel_sparse_matrix.h>
+
+#include <vector>
+
+using namespace dealii;
+
+// Assembles local matrices straight into the value arrays of distributed
+// PETSc AIJ matrices. For a given sparsity structure the position of every
+// (row, column) entry in the local diagonal or off-diagonal value array is
+// computed once; adding a local matrix is then a plain indexed update with
+// no row search or hashing. Entries in rows owned by other processors are
+// handed to MatSetValues, so compress() still has to be called afterwards.
+// All matrices sharing the structure (see SharedPatternMatrix) can use the
+// same offsets.
+class DirectAssembler
+{
+public:
+  DirectAssembler ();
+  ~DirectAssembler ();
+  
+  // Read the local CSR structure of pattern_matrix. It is kept until
+  // release_pattern () is called.
+  void initialize (const PETScWrappers::MPI::SparseMatrix &pattern_matrix);
+  void release_pattern ();
+  
+  // offsets[i*cols.size()+j] locates entry (rows[i], cols[j]); -1 marks
+  // entries that go through MatSetValues
+  void compute_offsets (const std::vector<types::global_dof_index> &rows,
+                        const std::vector<types::global_dof_index> &cols,
+                        std::vector<PetscInt> &offsets) const;
+  
+  void add (PETScWrappers::MPI::SparseMatrix &matrix,
+            const std::vector<PetscInt> &offsets,
+            const std::vector<types::global_dof_index> &rows,
+            const std::vector<types::global_dof_index> &cols,
+            const FullMatrix<double> &local_matrix,
+            const double factor = 1.0) const;
+  
+private:
+  PetscInt row_start;
+  PetscInt row_end;
+  PetscInt col_start;
+  PetscInt col_end;
+  PetscInt n_diag_nonzeros;
+  
+  std::vector<PetscInt> diag_row_ptr;
+  std::vector<PetscInt> diag_cols;
+  std::vector<PetscInt> offd_row_ptr;
+  std::vector<PetscInt> offd_global_cols;
+};
+
+#endif //__direct_assembler_h__
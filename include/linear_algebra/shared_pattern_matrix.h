@@ -0,0 +1,32 @@
+#ifndef __shared_pattern_matrix_h__
+#define __shared_pattern_matrix_h__
+
+#include <deal.II/lac/petsc_parallel_sparse_matrix.h>
+
+using namespace dealii;
+
+// A distributed PETSc AIJ matrix that can share the row offsets and column
+// indices of another matrix with the same parallel layout. Only the value
+// array is allocated per matrix, which roughly halves the memory of the
+// per-component HO/LO matrices for DFEM stencils.
+class SharedPatternMatrix : public PETScWrappers::MPI::SparseMatrix
+{
+public:
+  SharedPatternMatrix ();
+  ~SharedPatternMatrix ();
+  
+  // Replace the current matrix by a zero-valued duplicate of pattern_owner
+  // sharing its nonzero structure. pattern_owner has to be assembled and
+  // must stay alive as long as this matrix is in use. The base class state,
+  // communicator included, is that of pattern_owner's layout.
+  void reinit_with_shared_pattern
+  (const PETScWrappers::MPI::SparseMatrix &pattern_owner);
+  
+  // bytes on this processor; a sharing matrix counts its value array only
+  std::size_t memory_consumption () const;
+  
+private:
+  bool is_shared;
+};
+
+#endif //__shared_pattern_matrix_h__
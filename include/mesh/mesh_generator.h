@@ -13,12 +13,20 @@ public:
   ~MeshGenerator ();
   
   void make_grid (parallel::distributed::Triangulation<dim> &tria);
+  void make_coarse_grid (parallel::distributed::Triangulation<dim> &tria);
   void get_relevant_cell_iterators
   (DoFHandler<dim> &dof_handler,
    std::vector<typename DoFHandler<dim>::active_cell_iterator> &local_cells,
    std::vector<typename DoFHandler<dim>::active_cell_iterator> &ref_bd_cells,
    std::vector<bool> &is_cell_at_bd,
-   std::vector<bool> &is_cell_at_ref_bd);
+   std::vector<bool> &is_cell_at_ref_bd,
+   std::vector<std::pair<unsigned int, unsigned int> > &interior_faces,
+   std::vector<typename DoFHandler<dim>::cell_iterator> &interior_face_neighbors,
+   std::vector<unsigned int> &interior_face_neighbor_face_numbers,
+   std::vector<unsigned int> &interior_face_neighbor_subface_numbers,
+   std::vector<std::pair<unsigned int, unsigned int> > &vacuum_faces,
+   std::vector<std::pair<unsigned int, unsigned int> > &reflective_faces,
+   std::vector<unsigned int> &reflective_face_boundary_ids);
   unsigned int get_uniform_refinement ();
   std::map<std::vector<unsigned int>, unsigned int> get_id_map ();
   std::unordered_map<unsigned int, bool> get_reflective_bc_map ();
@@ -30,6 +38,10 @@ private:
   void initialize_relative_position_to_id_map (ParameterHandler &prm);
   void preprocess_reflective_bc (ParameterHandler &prm);
   void process_coordinate_information (ParameterHandler &prm);
+  void process_gmsh_tag_maps (ParameterHandler &prm);
+  unsigned long long gmsh_tag_map_hash () const;
+  void read_gmsh_coarse_grid (parallel::distributed::Triangulation<dim> &tria);
+  void parse_gmsh_file (std::vector<char> &buffer);
   // utility member functions
   void get_cell_relative_position
   (Point<dim> &position,
@@ -39,6 +51,10 @@ private:
   bool is_mesh_generated;
   bool have_reflective_bc;
   std::string mesh_filename;
+  std::string mesh_cache_filename;
+  bool use_elementary_tags;
+  std::map<unsigned int, unsigned int> gmsh_tag_to_material_id;
+  std::map<unsigned int, unsigned int> gmsh_tag_to_boundary_id;
   unsigned int global_refinements;
   std::map<std::vector<unsigned int>, unsigned int> relative_position_to_id;
   std::unordered_map<unsigned int, bool> is_reflective_bc;
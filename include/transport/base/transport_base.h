@@ -20,10 +20,12 @@ namespace LA
 #include <deal.II/lac/sparsity_tools.h>
 
 #include <deal.II/numerics/vector_tools.h>
+#include <deal.II/numerics/error_estimator.h>
 
 #include <deal.II/fe/fe_dgq.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/fe/fe_poly.h>
+#include <deal.II/fe/fe_values.h>
 
 #include <deal.II/dofs/dof_tools.h>
 
@@ -33,12 +35,15 @@ namespace LA
 #include <deal.II/base/conditional_ostream.h>
 
 #include <deal.II/distributed/tria.h>
+#include <deal.II/distributed/solution_transfer.h>
+#include <deal.II/distributed/grid_refinement.h>
 
 #include <deal.II/numerics/data_out.h>
 
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -46,9 +51,15 @@ namespace LA
 #include <vector>
 
 #include "../../common/problem_definition.h"
+#include "../../common/machine_profile.h"
+#include "../../common/memory_report.h"
+#include "../../common/profiler.h"
+#include "../../common/telemetry_stream.h"
 #include "../../mesh/mesh_generator.h"
 #include "../../material/material_properties.h"
 #include "../../aqdata/base/aq_base.h"
+#include "../../linear_algebra/shared_pattern_matrix.h"
+#include "../../linear_algebra/direct_assembler.h"
 
 using namespace dealii;
 
@@ -61,6 +72,20 @@ public:
   
   void run ();
   
+  // session interface: setup () once, then alternate solve () and
+  // update_material_properties () for cross-section branches
+  void setup ();
+  void solve ();
+  void update_material_properties (std_cxx11::shared_ptr<MaterialProperties> new_mat_ptr);
+  double get_keff () const;
+  // dry run: builds the coarse mesh only and prints the predicted memory per
+  // processor of the HO/LO system
+  void predict_memory ();
+  // plan only: builds the coarse mesh only and prints estimated sizes,
+  // memory, assembly work and source iteration time per processor count
+  // from a machine profile, with a recommended processor and thread count
+  void plan_job (ParameterHandler &prm);
+  
   virtual void pre_assemble_cell_matrices
   (const std_cxx11::shared_ptr<FEValues<dim> > fv,
    typename DoFHandler<dim>::active_cell_iterator &cell,
@@ -68,8 +93,7 @@ public:
    std::vector<FullMatrix<double> > &collision_at_qp);
   
   virtual void integrate_cell_bilinear_form
-  (const std_cxx11::shared_ptr<FEValues<dim> > fv,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
+  (unsigned int &ic,/*local cell index*/
    FullMatrix<double> &cell_matrix,
    unsigned int &i_dir,
    unsigned int &g,
@@ -78,7 +102,7 @@ public:
   
   virtual void integrate_boundary_bilinear_form
   (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
+   unsigned int &ic,/*local cell index*/
    unsigned int &fn,/*face number*/
    FullMatrix<double> &cell_matrix,
    unsigned int &i_dir,
@@ -86,7 +110,7 @@ public:
   
   virtual void integrate_reflective_boundary_linear_form
   (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
+   unsigned int &ic,/*local cell index*/
    unsigned int &fn,/*face number*/
    std::vector<Vector<double> > &cell_rhses,
    unsigned int &i_dir,
@@ -94,9 +118,8 @@ public:
   
   virtual void integrate_interface_bilinear_form
   (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
-   const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf_nei,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
-   typename DoFHandler<dim>::cell_iterator &neigh,/*cell iterator for cell*/
+   const std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fvf_nei,
+   unsigned int &ic,/*local cell index*/
    unsigned int &fn,/*concerning face number in local cell*/
    unsigned int &i_dir,
    unsigned int &g,
@@ -109,11 +132,42 @@ public:
   virtual void postprocess ();
   virtual void generate_ho_rhs ();
   virtual void generate_ho_fixed_source ();
+  // scattering source of group g computed from the given scalar fluxes
+  virtual void assemble_scattering_source (const std::vector<Vector<double> > &sflxes,
+                                           unsigned int g,
+                                           LA::MPI::Vector &rhs);
+  // lagged right-hand side coupling of the given components to their
+  // reflected partners on reflective boundaries
+  virtual void add_reflective_coupling_source (const std::vector<unsigned int> &components);
   
 private:
+  // global size of the HO system predicted from the coarse mesh
+  struct SystemSize
+  {
+    double n_cells;
+    double n_dofs;
+    double nnz_per_row;
+    unsigned int dofs_per_cell;
+    unsigned int n_q;
+    unsigned int n_shape_classes;
+  };
+  
   void setup_system ();
   void generate_globally_refined_grid ();
   void report_system ();
+  void report_memory ();
+  SystemSize estimate_system_size ();
+  void add_predicted_memory (MemoryReport &report,
+                             const SystemSize &size,
+                             unsigned int n_ranks);
+  double get_preconditioner_bytes (double local_rows, double local_nnz);
+  void estimate_job_cost (const SystemSize &size,
+                          const MachineProfile &profile,
+                          unsigned int n_ranks,
+                          unsigned int linear_iterations,
+                          double &assembly_flops,
+                          double &assembly_seconds,
+                          double &iteration_seconds);
   void print_angular_quad ();
   
   // void setup_lo_system();
@@ -125,16 +179,50 @@ private:
   void assemble_ho_system ();
   void do_iterations ();
   void process_input ();
+  void load_material_data ();
   void initialize_material_id ();
   void initialize_dealii_objects ();
+  void initialize_cell_face_cache ();
+  void initialize_cell_shape_classes ();
+  void integrate_boundary_faces_of_cell (unsigned int ic,
+                                         FullMatrix<double> &cell_matrix,
+                                         unsigned int i_dir,
+                                         unsigned int g);
   void initialize_system_matrices_vectors ();
+  void initialize_direct_assembly ();
+  void add_to_ho_matrix (unsigned int k,
+                         const std::vector<PetscInt> &offsets,
+                         const std::vector<types::global_dof_index> &rows,
+                         const std::vector<types::global_dof_index> &cols,
+                         const FullMatrix<double> &local_matrix);
+  void add_ho_cell_contributions (const std::vector<unsigned int> &cells,
+                                  const std::vector<std::vector<bool> > &is_changed,
+                                  double factor);
+  void add_ho_interface_contributions (const std::vector<unsigned int> &faces,
+                                       const std::vector<std::vector<bool> > &is_changed,
+                                       double factor);
   void assemble_lo_system ();
   void prepare_correction_aflx ();
   void initialize_ho_preconditioners ();
+  void initialize_ho_preconditioner (unsigned int i);
   void ho_solve ();
+  void ho_solve_component (unsigned int i);
+  void angular_multigrid_correction ();
+  void angular_multigrid_cycle (unsigned int level,
+                                const std::vector<LA::MPI::Vector> &residual,
+                                std::vector<LA::MPI::Vector> &correction);
   void lo_solve ();
   void refine_grid ();
-  void output_results () const;
+  unsigned int get_cost_model_weight (const typename Triangulation<dim>::cell_iterator &cell);
+  unsigned int get_cell_weight (const typename Triangulation<dim>::cell_iterator &cell,
+                                const typename Triangulation<dim>::CellStatus status);
+  void clear_system ();
+  void save_checkpoint (unsigned int generation);
+  void load_checkpoint ();
+  void transfer_restart_vectors (const FiniteElement<dim> &restart_fe, bool refine);
+  void apply_checkpoint ();
+  void output_results (const std::string &tag);
+  void finish_output ();
   void power_iteration ();
   void initialize_fiss_process ();
   void update_ho_moments_in_fiss ();
@@ -145,6 +233,8 @@ private:
   void NDA_PI ();
   void NDA_SI ();
   void initialize_aq (ParameterHandler &prm);
+  void choose_group_sn_orders (ParameterHandler &prm);
+  void combine_group_quadratures ();
   
   double estimate_k (double &fiss_source,
                      double &fiss_source_prev_gen,
@@ -159,6 +249,8 @@ private:
   std_cxx11::shared_ptr<MeshGenerator<dim> > msh_ptr;
   std_cxx11::shared_ptr<MaterialProperties> mat_ptr;
   std_cxx11::shared_ptr<AQBase<dim> > aqd_ptr;
+  // one set per distinct SN order when groups use different orders
+  std::map<unsigned int, std_cxx11::shared_ptr<AQBase<dim> > > group_aqs;
   std_cxx11::shared_ptr<SolverControl> gcn;
   
   std::string transport_model_name;
@@ -167,6 +259,18 @@ private:
   std::string discretization;
   std::string namebase;
   std::string aq_name;
+  std::string checkpoint_namebase;
+  std::string output_format;
+  std::string load_balancing;
+  
+  // assembly time per local cell, only with measured load balancing
+  std::vector<double> measured_cell_costs;
+  
+  DataOutBase::VtkFlags::ZlibCompressionLevel output_compression;
+  std::thread output_thread;
+  
+  // fluxes read by load_checkpoint () until the system exists
+  std::vector<std_cxx11::shared_ptr<LA::MPI::Vector> > restart_vectors;
   
 protected:
   unsigned int get_component_index (unsigned int incident_angle_index, unsigned int g);
@@ -175,6 +279,15 @@ protected:
   
   unsigned int get_reflective_direction_index (unsigned int boundary_id,
                                                unsigned int incident_angle_index);
+  unsigned int get_reflected_component (unsigned int k,
+                                        unsigned int boundary_id);
+  
+  // face values of the neighbor across interior face i_face, reinitialized
+  std_cxx11::shared_ptr<FEFaceValuesBase<dim> > reinit_neighbor_face_values (unsigned int i_face);
+  
+  void get_cell_values_at_qp (const Vector<double> &global_values,
+                              unsigned int ic,
+                              std::vector<double> &values_at_qp);
   
   void radio (std::string str);
   void radio (std::string str1, std::string str2);
@@ -191,12 +304,52 @@ protected:
   std::vector<bool> is_cell_at_bd;
   std::vector<bool> is_cell_at_ref_bd;
   
+  // flat face lists of (local cell index, face number) from MeshGenerator
+  std::vector<std::pair<unsigned int, unsigned int> > interior_faces;
+  std::vector<typename DoFHandler<dim>::cell_iterator> interior_face_neighbors;
+  std::vector<unsigned int> interior_face_neighbor_face_numbers;
+  // subface of the neighbor's face for faces of a finer local cell,
+  // invalid_unsigned_int for conforming faces
+  std::vector<unsigned int> interior_face_neighbor_subface_numbers;
+  std::vector<std::vector<types::global_dof_index> > interior_face_neighbor_dof_indices;
+  std::vector<std::pair<unsigned int, unsigned int> > vacuum_faces;
+  std::vector<std::pair<unsigned int, unsigned int> > reflective_faces;
+  std::vector<unsigned int> reflective_face_boundary_ids;
+  
+  // Cell and face cache in structure-of-arrays layout. It is built once after
+  // DoFs are distributed so iteration-time kernels never walk deal.II iterators.
+  // Face entries are stored per (cell, face) at ic*faces_per_cell+fn.
+  std::vector<std::vector<types::global_dof_index> > cell_dof_indices;
+  std::vector<unsigned int> cell_material_ids;
+  std::vector<std::vector<double> > cell_jxw;
+  std::vector<double> cell_measures;
+  std::vector<double> face_measures;
+  std::vector<Tensor<1, dim> > face_normals;
+  std::vector<unsigned int> face_boundary_ids;
+  std::vector<unsigned int> face_neighbor_indices;
+  std::vector<unsigned int> face_neighbor_material_ids;
+  std::vector<double> face_neighbor_measures;
+  FullMatrix<double> ref_shape_values;
+  
+  // pre-assembly shape class of each local cell and one representative cell
+  // per class; invalid_unsigned_int marks cells on the general path
+  std::vector<unsigned int> cell_shape_classes;
+  std::vector<unsigned int> shape_class_representatives;
+  
+  // value-array offsets of each local cell matrix and of the four blocks of
+  // each interior face (index 4*i_face+block: up-up, up-un, un-up, un-un);
+  // valid for every HO matrix since they share one structure
+  DirectAssembler direct_assembler;
+  std::vector<std::vector<PetscInt> > cell_matrix_offsets;
+  std::vector<std::vector<PetscInt> > interface_matrix_offsets;
+  
   FE_Poly<TensorProductPolynomials<dim>,dim,dim>* fe;
   std_cxx11::shared_ptr<QGauss<dim> > q_rule;
   std_cxx11::shared_ptr<QGauss<dim-1> > qf_rule;
   std_cxx11::shared_ptr<FEValues<dim> > fv;
   std_cxx11::shared_ptr<FEFaceValues<dim> > fvf;
   std_cxx11::shared_ptr<FEFaceValues<dim> > fvf_nei;
+  std_cxx11::shared_ptr<FESubfaceValues<dim> > fvf_nei_sub;
   
   
   MPI_Comm mpi_communicator;
@@ -225,25 +378,74 @@ protected:
   bool have_reflective_bc;
   bool is_explicit_reflective;
   bool do_print_sn_quad;
+  bool use_direct_assembly;
+  bool have_ho_preconditioners;
+  bool is_warm_start;
+  bool do_checkpoint_aflx;
+  bool do_restart;
+  bool do_output_subdomain;
+  bool do_background_output;
+  bool do_measure_cell_costs;
   
   unsigned int n_q;
   unsigned int n_qf;
   unsigned int dofs_per_cell;
   
+  // number of directions in the catalog, i.e. of all group sets together
   unsigned int n_dir;
   unsigned int n_azi;
+  std::vector<unsigned int> group_sn_orders;
+  // HO systems: the n_total_ho_vars components followed by those of the
+  // coarse angular multigrid levels
+  unsigned int n_ho_sys;
+  unsigned int n_mg_levels;
+  unsigned int n_mg_sweeps;
+  // per coarse level (finest coarse level first) and group
+  std::vector<std::vector<unsigned int> > mg_sn_orders;
+  std::vector<std::vector<unsigned int> > mg_first_component;
+  std::vector<std::vector<unsigned int> > mg_n_dir;
   unsigned int n_total_ho_vars;
   unsigned int n_group;
   unsigned int n_material;
   unsigned int p_order;
   unsigned int global_refinements;
-  
+  // memory for pre-assembled shape class matrices per processor
+  double pre_assembly_class_bytes;
+  unsigned int checkpoint_interval;
+  unsigned int restart_generation;
+  // material updates since setup and how often they reassemble fully
+  unsigned int n_material_updates;
+  unsigned int full_reassembly_interval;
+  unsigned int output_interval;
+  unsigned int n_refinement_cycles;
+  unsigned int source_cell_weight;
+  unsigned int boundary_face_weight;
+  unsigned int interface_weight;
+  
+  double refine_fraction;
+  double measured_cost_scale;
+  // resident set growth while the HO preconditioners were built and the
+  // transient pre-assembly matrices of the last volume assembly
+  double preconditioner_bytes;
+  double pre_assembly_bytes;
+  double coarsen_fraction;
+  
+  std::vector<unsigned int> output_groups;
+  
+  // of the last solve of every HO system, for the telemetry stream
   std::vector<unsigned int> linear_iters;
+  std::vector<double> linear_times;
+  std::vector<double> linear_residuals;
+  // power iteration generation of the running source iteration, 0 without
+  unsigned int current_generation;
+  unsigned int n_si_iterations;
   
   std::vector<types::global_dof_index> local_dof_indices;
   std::vector<types::global_dof_index> neigh_dof_indices;
   
-  // HO system
+  // HO system. vec_ho_sys[0] owns the sparsity structure that all other HO
+  // and LO matrices share (SharedPatternMatrix), so it has to outlive them:
+  // it is created first and destroyed last.
   std::vector<LA::MPI::SparseMatrix*> vec_ho_sys;
   std::vector<LA::MPI::Vector*> vec_aflx;
   std::vector<LA::MPI::Vector*> vec_ho_rhs;
@@ -280,16 +482,18 @@ protected:
   std::vector<Vector<double> > sflx_proc_prev_gen;
   std::vector<Vector<double> > lo_sflx_proc;
   
-  std::map<std::pair<unsigned int, unsigned int>, unsigned int> component_index;
   std::map<std::pair<unsigned int, unsigned int>, unsigned int> reflective_direction_index;
   std::map<std::vector<unsigned int>, unsigned int> relative_position_to_id;
-  std::unordered_map<unsigned int, std::pair<unsigned int, unsigned int> > inverse_component_index;
   std::unordered_map<unsigned int, bool> is_reflective_bc;
   std::unordered_map<unsigned int, bool> is_material_fissile;
   
   std::set<unsigned int> fissile_ids;
   
+  ComponentLayout component_layout;
+  
   ConditionalOStream pcout;
+  Profiler profiler;
+  TelemetryStream telemetry;
   
   std::vector<std_cxx11::shared_ptr<LA::MPI::PreconditionAMG> > pre_ho_amg;
   std::vector<std_cxx11::shared_ptr<PETScWrappers::PreconditionBlockJacobi> > pre_ho_bjacobi;
@@ -17,8 +17,7 @@ public:
    std::vector<FullMatrix<double> > &collision_at_qp);
   
   void integrate_cell_bilinear_form
-  (const std_cxx11::shared_ptr<FEValues<dim> > fv,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
+  (unsigned int &ic,/*local cell index*/
    FullMatrix<double> &cell_matrix,
    unsigned int &i_dir,
    unsigned int &g,
@@ -27,7 +26,7 @@ public:
   
   void integrate_boundary_bilinear_form
   (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
+   unsigned int &ic,/*local cell index*/
    unsigned int &fn,/*face number*/
    FullMatrix<double> &cell_matrix,
    unsigned int &i_dir,
@@ -35,9 +34,8 @@ public:
   
   void integrate_interface_bilinear_form
   (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
-   const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf_nei,
-   typename DoFHandler<dim>::active_cell_iterator &cell,
-   typename DoFHandler<dim>::cell_iterator &neigh,/*cell iterator for cell*/
+   const std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fvf_nei,
+   unsigned int &ic,/*local cell index*/
    unsigned int &fn,/*concerning face number in local cell*/
    unsigned int &i_dir,
    unsigned int &g,
@@ -48,6 +46,16 @@ public:
   
   void generate_ho_fixed_source ();
   void generate_ho_rhs ();
+  void assemble_scattering_source (const std::vector<Vector<double> > &sflxes,
+                                   unsigned int g,
+                                   LA::MPI::Vector &rhs);
+  void add_reflective_coupling_source (const std::vector<unsigned int> &components);
+  
+private:
+  double get_reflective_penalty (unsigned int ic,
+                                 unsigned int fn,
+                                 const Tensor<1,dim> &omega,
+                                 unsigned int g);
 };
 
 #endif // __even_parity__
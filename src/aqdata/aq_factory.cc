@@ -0,0 +1,31 @@
+#include "../../include/aqdata/aq_factory.h"
+#include "../../include/aqdata/derived/aq_lsgc.h"
+#include "../../include/aqdata/derived/aq_ls.h"
+#include "../../include/aqdata/derived/aq_pglc.h"
+#include "../../include/aqdata/derived/aq_lebedev.h"
+
+std::string get_aq_names ()
+{
+  return "lsgc|ls|pglc|lebedev";
+}
+
+template <int dim>
+std_cxx11::shared_ptr<AQBase<dim> > build_aq_model (ParameterHandler &prm)
+{
+  const std::string aq_name = prm.get ("angular quadrature name");
+  std_cxx11::shared_ptr<AQBase<dim> > aq;
+  if (aq_name=="lsgc")
+    aq = std_cxx11::shared_ptr<AQBase<dim> > (new AQLSGC<dim>(prm));
+  else if (aq_name=="ls")
+    aq = std_cxx11::shared_ptr<AQBase<dim> > (new AQLS<dim>(prm));
+  else if (aq_name=="pglc")
+    aq = std_cxx11::shared_ptr<AQBase<dim> > (new AQPGLC<dim>(prm));
+  else if (aq_name=="lebedev")
+    aq = std_cxx11::shared_ptr<AQBase<dim> > (new AQLebedev<dim>(prm));
+  AssertThrow (aq.get()!=0,
+               ExcMessage("unknown angular quadrature name " + aq_name));
+  return aq;
+}
+
+template std_cxx11::shared_ptr<AQBase<2> > build_aq_model<2> (ParameterHandler &prm);
+template std_cxx11::shared_ptr<AQBase<3> > build_aq_model<3> (ParameterHandler &prm);
@@ -1,6 +1,9 @@
 #include <deal.II/base/numbers.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <sstream>
 
 #include "../../../include/aqdata/base/aq_base.h"
 
@@ -10,6 +13,7 @@ AQBase<dim>::AQBase (ParameterHandler &prm)
 pi(numbers::PI),
 transport_model_name(prm.get("transport model")),
 aq_name(prm.get("angular quadrature name")),
+component_ordering(prm.get("component ordering")),
 n_group(prm.get_integer("number of groups")),
 n_azi(prm.get_integer("angular quadrature order")),
 have_reflective_bc(prm.get_bool("have reflective BC"))
@@ -31,6 +35,12 @@ void AQBase<dim>::make_aq (ParameterHandler &prm)
   initialize_ref_bc_index ();
 }
 
+template <int dim>
+void AQBase<dim>::set_sn_order (unsigned int order)
+{
+  n_azi = order;
+}
+
 template <int dim>
 void AQBase<dim>::initialize_ref_bc_index ()
 {
@@ -61,46 +71,165 @@ void AQBase<dim>::initialize_ref_bc_index ()
       boundary_normal_vectors[4][2] = -1.0;
       boundary_normal_vectors[5][2] = 1.0;
     }
+    // Directions are hashed by their rounded components such that the
+    // reflected direction of each direction is found with one lookup instead
+    // of a search over all directions
+    std::map<std::vector<long long>, unsigned int> direction_key_to_index;
+    for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
+      direction_key_to_index[get_direction_key (omega_i[i_dir])] = i_dir;
     for (unsigned int i=0; i<2*dim; ++i)
       for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
       {
         Tensor<1, dim> out_angle = omega_i[i_dir] - 2.0 * (boundary_normal_vectors[i] * omega_i[i_dir]) * boundary_normal_vectors[i];
-        //(omega_i[i_dir] *
-        // (1.0 - 2.0 * (boundary_normal_vectors[i] * omega_i[i_dir])));
-        for (unsigned int r_dir=0; r_dir<n_dir; ++r_dir)
-        {
-          Tensor<1, dim> d_dir = out_angle;
-          Tensor<1, dim> d_minus_dir = out_angle;
-          d_dir -= omega_i[r_dir];
-          d_minus_dir += omega_i[r_dir];
-          // Use caution about even parity using this std::map
-          if ((transport_model_name=="ep" &&
-               (d_dir.norm ()<1.0e-13 || d_minus_dir.norm ()<1.0e-13)) ||
-              (transport_model_name!="ep" && d_dir.norm ()<1.0e-13))
-            reflective_direction_index[std::make_pair (i, i_dir)] = r_dir;
-        }
+        std::map<std::vector<long long>, unsigned int>::iterator it =
+        direction_key_to_index.find (get_direction_key (out_angle));
+        // Use caution about even parity using this std::map: only one of
+        // each pair of opposite directions is stored
+        if (it==direction_key_to_index.end () && transport_model_name=="ep")
+          it = direction_key_to_index.find (get_direction_key (-1.0 * out_angle));
+        AssertThrow (it!=direction_key_to_index.end (),
+                     ExcMessage("Angular quadrature is not symmetric about reflective boundaries"));
+        reflective_direction_index[std::make_pair (i, i_dir)] = it->second;
       }
   }
 }
 
+template <int dim>
+std::vector<long long> AQBase<dim>::get_direction_key (const Tensor<1, dim> &omega)
+{
+  std::vector<long long> key (dim);
+  for (unsigned int d=0; d<dim; ++d)
+    key[d] = std::llround (omega[d] * 1.0e9);
+  return key;
+}
+
 template <int dim>
 void AQBase<dim>::produce_angular_quad ()
 {
 }
 
 template <int dim>
-void AQBase<dim>::initialize_component_index ()
+void AQBase<dim>::fold_full_sphere_set
+(const std::vector<Tensor<1, 3> > &directions,
+ const std::vector<double> &weights)
 {
-  // initialize the map from (direction, group) to component indices
-  unsigned int ind = 0;
-  for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
-    for (unsigned int g=0; g<n_group; ++g)
+  const double tol = 1.0e-12;
+  double weight_sum = 0.0;
+  for (unsigned int i=0; i<directions.size(); ++i)
+  {
+    std::vector<Tensor<1, 3> > images (1, directions[i]);
+    if (dim==2)
+    {
+      Tensor<1, 3> flipped = directions[i];
+      flipped[2] = -flipped[2];
+      images.push_back (flipped);
+    }
+    if (transport_model_name=="ep")
+      for (unsigned int j=0, n=images.size(); j<n; ++j)
+        images.push_back (-1.0 * images[j]);
+
+    // the representative is the largest image in (z, y, x) order
+    unsigned int n_distinct = 0;
+    Tensor<1, 3> rep = directions[i];
+    for (unsigned int j=0; j<images.size(); ++j)
     {
-      std::pair<unsigned int, unsigned int> key (i_dir, g);
-      component_index[key] = ind;
-      inverse_component_index[ind] = key;
-      ind += 1;
+      bool is_new = true;
+      for (unsigned int k=0; k<j; ++k)
+        if ((images[j]-images[k]).norm ()<tol)
+          is_new = false;
+      n_distinct += is_new;
+      for (int d=2; d>=0; --d)
+        if (std::fabs (images[j][d]-rep[d])>tol)
+        {
+          if (images[j][d]>rep[d])
+            rep = images[j];
+          break;
+        }
     }
+    weight_sum += weights[i];
+    if ((rep-directions[i]).norm ()>tol)
+      continue;
+    Tensor<1, dim> omega;
+    for (unsigned int d=0; d<dim; ++d)
+      omega[d] = directions[i][d];
+    omega_i.push_back (omega);
+    wi.push_back (weights[i] * n_distinct);
+  }
+  AssertThrow (std::fabs (weight_sum-4.0*pi)<1.0e-10*4.0*pi,
+               ExcMessage("full-sphere angular weights have to sum to 4 pi"));
+}
+
+template <int dim>
+void AQBase<dim>::finalize_angular_quad ()
+{
+  total_angle = 4.0 * pi;
+  n_dir = omega_i.size ();
+  n_total_ho_vars = n_dir * n_group;
+  // estimate tensor norm to do penalty method for EP
+  if (transport_model_name=="ep" &&
+      discretization=="dfem")
+    for (unsigned int i=0; i<n_dir; ++i)
+    {
+      Tensor<2, dim> tensor_tmp = outer_product(omega_i[i], omega_i[i]);
+      tensor_norms.push_back(tensor_tmp.norm());
+    }
+}
+
+// Accuracy is measured on the monomials x^p y^q z^r with even exponents:
+// they are invariant under the folded symmetries, so the stored set
+// integrates them exactly as the full-sphere set does (the odd ones vanish
+// by symmetry). In 2D, z is recovered from the unit length. "Exact" means
+// a relative error below 1e-6.
+template <int dim>
+std::string AQBase<dim>::produce_accuracy_summary ()
+{
+  // tabulated LQn cosines carry seven digits
+  const double tol = 1.0e-6;
+  const unsigned int max_degree = 2 * n_azi + 4;
+  unsigned int exact_degree = 0;
+  double first_error = 0.0;
+  for (unsigned int degree=0; degree<=max_degree; degree+=2)
+  {
+    double max_error = 0.0;
+    for (unsigned int p=0; p<=degree; p+=2)
+      for (unsigned int q=0; q<=degree-p; q+=2)
+      {
+        const unsigned int r = degree - p - q;
+        double exact =
+        2.0 * std::tgamma (0.5*(p+1)) * std::tgamma (0.5*(q+1)) *
+        std::tgamma (0.5*(r+1)) / std::tgamma (0.5*(degree+3));
+        double sum = 0.0;
+        for (unsigned int i=0; i<omega_i.size(); ++i)
+        {
+          double x = omega_i[i][0], y = omega_i[i][1];
+          double z = (dim==3 ? omega_i[i][dim-1] :
+                      std::sqrt (std::max (0.0, 1.0-x*x-y*y)));
+          sum += wi[i] * std::pow (x, p) * std::pow (y, q) * std::pow (z, r);
+        }
+        max_error = std::max (max_error, std::fabs (sum-exact)/exact);
+      }
+    if (max_error>tol)
+    {
+      first_error = max_error;
+      break;
+    }
+    exact_degree = degree;
+  }
+  std::ostringstream os;
+  os << produce_quadrature_name () << " order " << n_azi
+  << ": " << n_dir << " directions, even moments exact through degree "
+  << exact_degree;
+  if (first_error>0.0)
+    os << ", max relative error at degree " << exact_degree+2
+    << ": " << first_error;
+  return os.str ();
+}
+
+template <int dim>
+void AQBase<dim>::initialize_component_index ()
+{
+  // arithmetic map from (direction, group) to component indices
+  component_layout = ComponentLayout (n_dir, n_group, component_ordering);
 }
 
 template <int dim>
@@ -123,6 +252,7 @@ void AQBase<dim>::print_angular_quad ()
     quadr << omega_i[i][1] << ", ";
     quadr << mu << std::endl;
   }
+  quadr << produce_accuracy_summary () << std::endl;
   quadr.close ();
 }
 
@@ -131,24 +261,22 @@ std::string AQBase<dim>::produce_quadrature_name ()
 {
   AssertThrow (aq_name.size()>0,
                ExcMessage("aq name has to be assigned before getting a physical name"));
-  // ToDo: more quadrature name producers
   if (aq_name=="lsgc")
     return "Level Symmetric Gauss Chebyshev";
+  if (aq_name=="ls")
+    return "Level Symmetric";
+  if (aq_name=="pglc")
+    return "Product Gauss-Legendre-Chebyshev";
+  if (aq_name=="lebedev")
+    return "Lebedev";
+  return aq_name;
 }
 
 //public member functions to retrieve private and protected variables
 template <int dim>
-std::map<std::pair<unsigned int, unsigned int>, unsigned int>
-AQBase<dim>::get_component_index_map ()
-{
-  return component_index;
-}
-
-template <int dim>
-std::unordered_map<unsigned int, std::pair<unsigned int, unsigned int> >
-AQBase<dim>::get_inv_component_map ()
+ComponentLayout AQBase<dim>::get_component_layout ()
 {
-  return inverse_component_index;
+  return component_layout;
 }
 
 template <int dim>
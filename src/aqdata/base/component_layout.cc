@@ -0,0 +1,91 @@
+#include <deal.II/base/exceptions.h>
+
+#include "../../../include/aqdata/base/component_layout.h"
+
+using namespace dealii;
+
+ComponentLayout::ComponentLayout ()
+:
+is_group_major(false),
+is_uniform(true),
+n_base(0),
+n_dir(0),
+n_group(0)
+{
+}
+
+ComponentLayout::ComponentLayout (unsigned int n_dir,
+                                  unsigned int n_group,
+                                  std::string ordering)
+:
+is_group_major(ordering=="group-major"),
+is_uniform(true),
+n_base(n_dir*n_group),
+n_dir(n_dir),
+n_group(n_group)
+{
+  AssertThrow (ordering=="direction-major" || ordering=="group-major",
+               ExcMessage("component ordering must be direction-major or group-major"));
+  // the tables are only read for added components, which come after these
+  for (unsigned int k=0; k<n_base; ++k)
+  {
+    component_direction.push_back (direction (k));
+    component_group.push_back (group (k));
+  }
+}
+
+ComponentLayout::ComponentLayout
+(const std::vector<unsigned int> &group_first_direction,
+ const std::vector<unsigned int> &group_n_dir)
+:
+is_group_major(true),
+is_uniform(false),
+n_base(0),
+n_dir(0),
+n_group(group_n_dir.size ()),
+group_first_direction(group_first_direction),
+group_offset(1, 0)
+{
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    group_offset.push_back (group_offset[g] + group_n_dir[g]);
+    for (unsigned int i=0; i<group_n_dir[g]; ++i)
+    {
+      component_direction.push_back (group_first_direction[g] + i);
+      component_group.push_back (g);
+    }
+  }
+  n_base = group_offset.back ();
+}
+
+ComponentLayout::~ComponentLayout ()
+{
+}
+
+unsigned int ComponentLayout::add_components (unsigned int first_direction,
+                                              unsigned int n,
+                                              unsigned int g)
+{
+  const unsigned int first = component_direction.size ();
+  for (unsigned int i=0; i<n; ++i)
+  {
+    component_direction.push_back (first_direction + i);
+    component_group.push_back (g);
+  }
+  return first;
+}
+
+unsigned int ComponentLayout::get_n_components () const
+{
+  return n_base;
+}
+
+unsigned int ComponentLayout::get_n_added_components () const
+{
+  return component_direction.size () - n_base;
+}
+
+std::string ComponentLayout::get_ordering () const
+{
+  return (is_group_major ? "group-major" : "direction-major");
+}
@@ -0,0 +1,100 @@
+#include "../../../include/aqdata/derived/aq_lebedev.h"
+
+namespace
+{
+  // Lebedev orbit generators: all sign and coordinate permutations of
+  //   a1 (1,0,0), a2 (0,r,r), a3 (s,s,s), b (l,l,m), c (p,q,0)
+  // with r^2 = 1/2, s^2 = 1/3, m^2 = 1-2l^2 and q^2 = 1-p^2
+  void add_orbit (const double x, const double y, const double z,
+                  const double w,
+                  std::vector<Tensor<1, 3> > &directions,
+                  std::vector<double> &weights)
+  {
+    const double v[3] = {x, y, z};
+    const unsigned int perm[6][3] =
+    {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};
+    const unsigned int n_before = directions.size ();
+    for (unsigned int p=0; p<6; ++p)
+      for (unsigned int octant=0; octant<8; ++octant)
+      {
+        Tensor<1, 3> omega;
+        for (unsigned int d=0; d<3; ++d)
+          omega[d] = ((octant>>d)&1 ? -1.0 : 1.0) * v[perm[p][d]];
+        bool is_new = true;
+        for (unsigned int i=n_before; i<directions.size(); ++i)
+          if ((directions[i]-omega).norm ()<1.0e-12)
+            is_new = false;
+        if (is_new)
+        {
+          directions.push_back (omega);
+          weights.push_back (w);
+        }
+      }
+  }
+}
+
+template <int dim>
+AQLebedev<dim>::AQLebedev (ParameterHandler &prm)
+:
+AQBase<dim> (prm)
+{
+}
+
+template <int dim>
+AQLebedev<dim>::~AQLebedev ()
+{
+}
+
+// Order n selects the rule of degree n+1 (6, 14, 26, 38 and 50 points for
+// n = 2 to 10). Lebedev sets are invariant under the octahedral group, so
+// every reflection on an axis-aligned boundary maps the set onto itself.
+template <int dim>
+void AQLebedev<dim>::produce_angular_quad ()
+{
+  AssertThrow (this->n_azi%2==0 && this->n_azi>=2 && this->n_azi<=10,
+               ExcMessage("Lebedev sets are available for orders 2 to 10"));
+  const double r = std::sqrt (0.5);
+  const double s = std::sqrt (1.0/3.0);
+  std::vector<Tensor<1, 3> > directions;
+  std::vector<double> weights;
+  switch (this->n_azi)
+  {
+    case 2:
+      add_orbit (1.0, 0.0, 0.0, 1.0/6.0, directions, weights);
+      break;
+    case 4:
+      add_orbit (1.0, 0.0, 0.0, 1.0/15.0, directions, weights);
+      add_orbit (s, s, s, 3.0/40.0, directions, weights);
+      break;
+    case 6:
+      add_orbit (1.0, 0.0, 0.0, 1.0/21.0, directions, weights);
+      add_orbit (0.0, r, r, 4.0/105.0, directions, weights);
+      add_orbit (s, s, s, 9.0/280.0, directions, weights);
+      break;
+    case 8:
+    {
+      const double p = 0.4597008433809831;
+      add_orbit (1.0, 0.0, 0.0, 1.0/105.0, directions, weights);
+      add_orbit (s, s, s, 9.0/280.0, directions, weights);
+      add_orbit (p, std::sqrt (1.0-p*p), 0.0, 1.0/35.0, directions, weights);
+      break;
+    }
+    case 10:
+    {
+      const double l = 1.0 / std::sqrt (11.0);
+      add_orbit (1.0, 0.0, 0.0, 4.0/315.0, directions, weights);
+      add_orbit (0.0, r, r, 64.0/2835.0, directions, weights);
+      add_orbit (s, s, s, 27.0/1280.0, directions, weights);
+      add_orbit (l, l, std::sqrt (1.0-2.0*l*l), 14641.0/725760.0,
+                 directions, weights);
+      break;
+    }
+  }
+  for (unsigned int i=0; i<weights.size(); ++i)
+    weights[i] *= 4.0 * this->pi;
+  this->fold_full_sphere_set (directions, weights);
+  this->finalize_angular_quad ();
+}
+
+template class AQLebedev<2>;
+template class AQLebedev<3>;
@@ -0,0 +1,90 @@
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/vector.h>
+
+#include <algorithm>
+
+#include "../../../include/aqdata/derived/aq_ls.h"
+
+template <int dim>
+AQLS<dim>::AQLS (ParameterHandler &prm)
+:
+AQBase<dim> (prm)
+{
+}
+
+template <int dim>
+AQLS<dim>::~AQLS ()
+{
+}
+
+// Level-symmetric LQn: the same n/2 cosines on every axis, mu_i^2 =
+// mu_1^2 + (i-1) * 2(1-3 mu_1^2)/(n-2), and one weight per class of
+// points that are permutations of each other. mu_1 is the standard LQn
+// value; the class weights integrate mu^(2k) exactly for k < n/2. Orders
+// above 12 would need extra moment conditions and are not provided.
+template <int dim>
+void AQLS<dim>::produce_angular_quad ()
+{
+  AssertThrow (this->n_azi%2==0 && this->n_azi>=2 && this->n_azi<=12,
+               ExcMessage("level-symmetric sets are available for SN orders 2 to 12"));
+  const double mu1_table[] =
+  {0.5773502692, 0.3500212, 0.2666355, 0.2182179, 0.1893213, 0.1672126};
+  const unsigned int n_level = this->n_azi / 2;
+  std::vector<double> mu (n_level);
+  mu[0] = mu1_table[n_level-1];
+  const double delta = (n_level>1 ?
+                        2.0 * (1.0 - 3.0 * mu[0] * mu[0]) / (this->n_azi - 2) : 0.0);
+  for (unsigned int i=1; i<n_level; ++i)
+    mu[i] = std::sqrt (mu[0] * mu[0] + i * delta);
+
+  // octant points are the level index triples summing to n_level-1
+  std::vector<std::vector<unsigned int> > points;
+  std::vector<unsigned int> point_class;
+  std::map<std::vector<unsigned int>, unsigned int> classes;
+  for (unsigned int i=0; i<n_level; ++i)
+    for (unsigned int j=0; i+j<n_level; ++j)
+    {
+      std::vector<unsigned int> point {i, j, n_level-1-i-j};
+      std::vector<unsigned int> key = point;
+      std::sort (key.begin(), key.end());
+      if (classes.find (key)==classes.end ())
+      {
+        const unsigned int n_class = classes.size ();
+        classes[key] = n_class;
+      }
+      points.push_back (point);
+      point_class.push_back (classes[key]);
+    }
+
+  // weights per octant sum to one; the mu^2 row repeats the first one, which
+  // the least-squares solve tolerates since the columns stay independent
+  FullMatrix<double> moments (n_level, classes.size ());
+  Vector<double> rhs (n_level), class_weights (classes.size ());
+  for (unsigned int k=0; k<n_level; ++k)
+  {
+    for (unsigned int p=0; p<points.size(); ++p)
+      moments(k, point_class[p]) += std::pow (mu[points[p][0]], 2.0*k);
+    rhs(k) = 1.0 / (2.0 * k + 1.0);
+  }
+  moments.least_squares (class_weights, rhs);
+  for (unsigned int c=0; c<class_weights.size(); ++c)
+    AssertThrow (class_weights(c)>0.0,
+                 ExcMessage("level-symmetric weights have to be positive"));
+
+  std::vector<Tensor<1, 3> > directions;
+  std::vector<double> weights;
+  for (unsigned int octant=0; octant<8; ++octant)
+    for (unsigned int p=0; p<points.size(); ++p)
+    {
+      Tensor<1, 3> omega;
+      for (unsigned int d=0; d<3; ++d)
+        omega[d] = ((octant>>d)&1 ? -1.0 : 1.0) * mu[points[p][d]];
+      directions.push_back (omega);
+      weights.push_back (class_weights(point_class[p]) * 0.5 * this->pi);
+    }
+  this->fold_full_sphere_set (directions, weights);
+  this->finalize_angular_quad ();
+}
+
+template class AQLS<2>;
+template class AQLS<3>;
@@ -0,0 +1,51 @@
+#include <deal.II/base/quadrature_lib.h>
+
+#include "../../../include/aqdata/derived/aq_pglc.h"
+
+template <int dim>
+AQPGLC<dim>::AQPGLC (ParameterHandler &prm)
+:
+AQBase<dim> (prm)
+{
+}
+
+template <int dim>
+AQPGLC<dim>::~AQPGLC ()
+{
+}
+
+// Product set: n Gauss-Legendre polar cosines times n/2 equally spaced
+// (Chebyshev) azimuths per quadrant on every level, 2n^2 directions on the
+// sphere before folding.
+template <int dim>
+void AQPGLC<dim>::produce_angular_quad ()
+{
+  AssertThrow (this->n_azi%2==0,
+               ExcMessage("SN order must be even numbers"));
+  QGauss<1> mu_quad (this->n_azi);
+  const unsigned int n_phi = 2 * this->n_azi;
+  const double dphi = 2.0 * this->pi / n_phi;
+
+  std::vector<Tensor<1, 3> > directions;
+  std::vector<double> weights;
+  for (unsigned int i=0; i<this->n_azi; ++i)
+  {
+    const double mu = mu_quad.point(i)[0] * 2.0 - 1.0;
+    const double w_pt = mu_quad.weight(i) * 4.0 * this->pi / n_phi;
+    for (unsigned int j=0; j<n_phi; ++j)
+    {
+      const double phi = (j + 0.5) * dphi;
+      Tensor<1, 3> omega;
+      omega[0] = std::sqrt (1.0 - mu * mu) * std::cos (phi);
+      omega[1] = std::sqrt (1.0 - mu * mu) * std::sin (phi);
+      omega[2] = mu;
+      directions.push_back (omega);
+      weights.push_back (w_pt);
+    }
+  }
+  this->fold_full_sphere_set (directions, weights);
+  this->finalize_angular_quad ();
+}
+
+template class AQPGLC<2>;
+template class AQPGLC<3>;
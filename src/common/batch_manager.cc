@@ -0,0 +1,265 @@
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/timer.h>
+#include <deal.II/base/utilities.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "../../include/common/batch_manager.h"
+#include "../../include/common/problem_definition.h"
+#include "../../include/material/material_properties.h"
+#include "../../include/transport/base/transport_base.h"
+#include "../../include/transport/derived/even_parity.h"
+
+BatchManager::BatchManager (const std::string &case_list_name)
+:
+case_list_name(case_list_name)
+{
+}
+
+BatchManager::~BatchManager ()
+{
+}
+
+void BatchManager::read_case_list ()
+{
+  std::ifstream case_list (case_list_name.c_str ());
+  AssertThrow (case_list.good (),
+               ExcMessage("cannot open case list " + case_list_name));
+  
+  std::string line;
+  while (std::getline (case_list, line))
+  {
+    boost::trim (line);
+    if (line.empty () || line[0]=='#')
+      continue;
+    
+    std::vector<std::string> fields;
+    boost::split (fields, line, boost::is_any_of ("|"));
+    std::string input_file_name = boost::trim_copy (fields[0]);
+    
+    std_cxx11::shared_ptr<ParameterHandler> prm (new ParameterHandler);
+    ProblemDefinition::declare_parameters (*prm);
+    prm->read_input (input_file_name);
+    
+    // "a::b::entry = value": the value never contains '=' while entry and
+    // subsection names may, so split at the last one
+    for (unsigned int i=1; i<fields.size(); ++i)
+    {
+      std::string::size_type pos = fields[i].rfind ('=');
+      AssertThrow (pos!=std::string::npos,
+                   ExcMessage("override without '=': " + fields[i]));
+      std::string path = boost::trim_copy (fields[i].substr (0, pos));
+      std::string value = boost::trim_copy (fields[i].substr (pos+1));
+      std::vector<std::string> sections;
+      boost::split (sections, path, boost::is_any_of (":"), boost::token_compress_on);
+      for (unsigned int s=0; s+1<sections.size(); ++s)
+        prm->enter_subsection (boost::trim_copy (sections[s]));
+      prm->set (boost::trim_copy (sections.back ()), value);
+      for (unsigned int s=0; s+1<sections.size(); ++s)
+        prm->leave_subsection ();
+    }
+    
+    case_descriptions.push_back (line);
+    case_prms.push_back (prm);
+  }
+  AssertThrow (case_prms.size()>0,
+               ExcMessage("case list " + case_list_name + " has no cases"));
+}
+
+// Parameters that fix the mesh, DoFs, angular quadrature and linear solver.
+// Cases that agree on all of them can share one model.
+std::string BatchManager::get_setup_key (ParameterHandler &prm)
+{
+  static const char *setup_entries[] =
+  {
+    "problem dimension",
+    "transport model",
+    "preconditioner name",
+    "ssor factor",
+    "linear solver name",
+    "angular quadrature name",
+    "angular quadrature order",
+    "angular quadrature orders per group",
+    "automatic angular orders",
+    "minimum angular quadrature order",
+    "angular multigrid levels",
+    "component ordering",
+    "number of groups",
+    "spatial discretization",
+    "do eigenvalue calculations",
+    "do NDA",
+    "have reflective BC",
+    "reflective boundary names",
+    "finite element polynomial degree",
+    "uniform refinements",
+    "pre-assembly shape class memory in MB",
+    "use direct matrix assembly",
+    "x, y, z max values of boundary locations",
+    "number of cells for x, y, z directions",
+    "number of materials",
+    "is mesh generated by deal.II",
+    "mesh file name",
+    "use explicit reflective boundary condition or not",
+    "gmsh tag kind",
+    "gmsh material tag map",
+    "gmsh boundary tag map"
+  };
+  
+  std::ostringstream key;
+  for (unsigned int i=0; i<sizeof(setup_entries)/sizeof(setup_entries[0]); ++i)
+    key << prm.get (setup_entries[i]) << ";";
+  prm.enter_subsection ("material ID map");
+  key << prm.get ("material id file name");
+  prm.leave_subsection ();
+  return key.str ();
+}
+
+// Entries outside all subsections, i.e. everything but the material data
+std::map<std::string, std::string> BatchManager::get_top_level_entries (ParameterHandler &prm)
+{
+  std::ostringstream os;
+  prm.print_parameters (os, ParameterHandler::ShortText);
+  std::istringstream is (os.str ());
+  
+  std::map<std::string, std::string> entries;
+  unsigned int depth = 0;
+  std::string line;
+  while (std::getline (is, line))
+  {
+    boost::trim (line);
+    if (boost::starts_with (line, "subsection "))
+      ++depth;
+    else if (line=="end")
+      --depth;
+    else if (depth==0 && boost::starts_with (line, "set "))
+    {
+      std::string::size_type pos = line.find ('=');
+      if (pos!=std::string::npos)
+        entries[boost::trim_copy (line.substr (4, pos-4))] =
+        boost::trim_copy (line.substr (pos+1));
+    }
+  }
+  return entries;
+}
+
+// A reused case keeps the model of the first case of its group and thus all
+// of its parameters except the cross sections; warn about the ones that
+// differ but are not part of the setup key
+void BatchManager::warn_ignored_parameters (unsigned int first_case, unsigned int c)
+{
+  std::map<std::string, std::string> first = get_top_level_entries (*case_prms[first_case]);
+  std::map<std::string, std::string> entries = get_top_level_entries (*case_prms[c]);
+  std::string ignored;
+  for (std::map<std::string, std::string>::iterator it=entries.begin (); it!=entries.end (); ++it)
+    if (first[it->first]!=it->second)
+      ignored += (ignored.empty () ? "" : ", ") + it->first;
+  if (!ignored.empty () &&
+      Utilities::MPI::this_mpi_process (MPI_COMM_WORLD)==0)
+    std::cerr << "Warning: case " << c << " reuses the model of case " << first_case
+    << " and runs with its values of: " << ignored << std::endl;
+}
+
+void BatchManager::run ()
+{
+  read_case_list ();
+  
+  // groups are numbered in order of first appearance
+  std::map<std::string, unsigned int> key_to_group;
+  std::vector<std::vector<unsigned int> > groups;
+  for (unsigned int i=0; i<case_prms.size(); ++i)
+  {
+    std::string key = get_setup_key (*case_prms[i]);
+    if (key_to_group.find (key)==key_to_group.end ())
+    {
+      key_to_group[key] = groups.size ();
+      groups.push_back (std::vector<unsigned int> ());
+    }
+    case_groups.push_back (key_to_group[key]);
+    groups[key_to_group[key]].push_back (i);
+    if (groups[key_to_group[key]].size()>1)
+      warn_ignored_parameters (groups[key_to_group[key]][0], i);
+    is_case_eigen.push_back (case_prms[i]->get_bool ("do eigenvalue calculations"));
+  }
+  case_keffs.resize (case_prms.size(), 0.0);
+  case_wall_times.resize (case_prms.size(), 0.0);
+  is_case_setup.resize (case_prms.size(), false);
+  
+  for (unsigned int i=0; i<groups.size(); ++i)
+  {
+    ParameterHandler &prm = *case_prms[groups[i][0]];
+    AssertThrow (prm.get ("transport model")=="ep",
+                 ExcMessage("only even parity is implemented"));
+    unsigned int dim = prm.get_integer ("problem dimension");
+    AssertThrow (dim==2 || dim==3,
+                 ExcMessage("1D is not implemented"));
+    if (dim==2)
+      run_group<2> (groups[i]);
+    else
+      run_group<3> (groups[i]);
+  }
+  
+  write_summary ();
+}
+
+template <int dim>
+void BatchManager::run_group (const std::vector<unsigned int> &group_cases)
+{
+  std_cxx11::shared_ptr<TransportBase<dim> > tb;
+  for (unsigned int i=0; i<group_cases.size(); ++i)
+  {
+    unsigned int c = group_cases[i];
+    Timer timer (MPI_COMM_WORLD, true);
+    if (i==0)
+    {
+      tb = std_cxx11::shared_ptr<TransportBase<dim> > (new EvenParity<dim>(*case_prms[c]));
+      tb->setup ();
+      is_case_setup[c] = true;
+    }
+    else
+      tb->update_material_properties (std_cxx11::shared_ptr<MaterialProperties>
+                                      (new MaterialProperties(*case_prms[c])));
+    tb->solve ();
+    timer.stop ();
+    case_keffs[c] = tb->get_keff ();
+    case_wall_times[c] = timer.wall_time ();
+  }
+}
+
+void BatchManager::write_summary ()
+{
+  if (Utilities::MPI::this_mpi_process (MPI_COMM_WORLD)!=0)
+    return;
+  
+  std::ostringstream os;
+  os << std::left
+  << std::setw(6) << "case"
+  << std::setw(7) << "group"
+  << std::setw(7) << "setup"
+  << std::setw(14) << "keff"
+  << std::setw(12) << "wall [s]"
+  << "input" << std::endl;
+  for (unsigned int i=0; i<case_prms.size(); ++i)
+  {
+    os << std::left
+    << std::setw(6) << i
+    << std::setw(7) << case_groups[i]
+    << std::setw(7) << (is_case_setup[i] ? "full" : "reuse");
+    if (is_case_eigen[i])
+      os << std::setw(14) << std::setprecision(8) << std::fixed << case_keffs[i];
+    else
+      os << std::setw(14) << "-";
+    os << std::setw(12) << std::setprecision(3) << std::fixed << case_wall_times[i]
+    << case_descriptions[i] << std::endl;
+    os.unsetf (std::ios_base::floatfield);
+  }
+  
+  std::cout << std::endl << os.str () << std::endl;
+  std::ofstream summary ((case_list_name + ".summary").c_str ());
+  summary << os.str ();
+}
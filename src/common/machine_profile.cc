@@ -0,0 +1,74 @@
+#include <deal.II/base/utilities.h>
+
+#include <fstream>
+#include <iomanip>
+
+#include "../../include/common/machine_profile.h"
+
+MachineProfile::MachineProfile ()
+:
+calibration_processes(1),
+cores_per_node(32),
+memory_per_node_mb(128.0 * 1024.0),
+assembly_gflops(1.0),
+stream_gbs(4.0),
+matrix_vector_gbs(4.0),
+allreduce_latency(5.0e-6),
+calibrated(false)
+{
+}
+
+MachineProfile::~MachineProfile ()
+{
+}
+
+void MachineProfile::declare_parameters (ParameterHandler &prm)
+{
+  prm.declare_entry ("calibration processes", "1", Patterns::Integer (1), "MPI processes of the calibration run");
+  prm.declare_entry ("cores per node", "32", Patterns::Integer (1), "");
+  prm.declare_entry ("memory per node in MB", "131072", Patterns::Double (0.0), "");
+  prm.declare_entry ("assembly GFLOP/s per processor", "1.0", Patterns::Double (0.0), "local matrix kernels");
+  prm.declare_entry ("stream GB/s per processor", "4.0", Patterns::Double (0.0), "scattering source and moment kernels");
+  prm.declare_entry ("matrix-vector GB/s per processor", "4.0", Patterns::Double (0.0), "HO matrix-vector products");
+  prm.declare_entry ("allreduce latency in seconds", "5e-6", Patterns::Double (0.0), "");
+}
+
+void MachineProfile::read (const std::string &filename)
+{
+  if (filename=="")
+    return;
+  ParameterHandler prm;
+  declare_parameters (prm);
+  prm.read_input (filename);
+  calibration_processes = prm.get_integer ("calibration processes");
+  cores_per_node = prm.get_integer ("cores per node");
+  memory_per_node_mb = prm.get_double ("memory per node in MB");
+  assembly_gflops = prm.get_double ("assembly GFLOP/s per processor");
+  stream_gbs = prm.get_double ("stream GB/s per processor");
+  matrix_vector_gbs = prm.get_double ("matrix-vector GB/s per processor");
+  allreduce_latency = prm.get_double ("allreduce latency in seconds");
+  AssertThrow (assembly_gflops>0.0 && stream_gbs>0.0 && matrix_vector_gbs>0.0,
+               ExcMessage("machine profile " + filename + " has zero rates"));
+  calibrated = true;
+}
+
+void MachineProfile::write (const std::string &filename) const
+{
+  std::ofstream out (filename.c_str ());
+  AssertThrow (out.good (),
+               ExcMessage("cannot open machine profile " + filename));
+  out << "# xtrans machine profile, rates per MPI processor" << std::endl
+  << std::setprecision (6)
+  << "set calibration processes            = " << calibration_processes << std::endl
+  << "set cores per node                   = " << cores_per_node << std::endl
+  << "set memory per node in MB            = " << memory_per_node_mb << std::endl
+  << "set assembly GFLOP/s per processor   = " << assembly_gflops << std::endl
+  << "set stream GB/s per processor        = " << stream_gbs << std::endl
+  << "set matrix-vector GB/s per processor = " << matrix_vector_gbs << std::endl
+  << "set allreduce latency in seconds     = " << allreduce_latency << std::endl;
+}
+
+bool MachineProfile::is_calibrated () const
+{
+  return calibrated;
+}
@@ -10,6 +10,7 @@
 
 #include "../../include/common/problem_definition.h"
 #include "../../include/common/model_manager.h"
+#include "../../include/common/batch_manager.h"
 
 using namespace dealii;
 
@@ -19,9 +20,17 @@ int main(int argc, char *argv[])
   {
     using namespace dealii;
     
+    if (argc==3 && std::string(argv[1])=="--batch")
+    {
+      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, 1);
+      BatchManager batch (argv[2]);
+      batch.run ();
+      return 0;
+    }
     if (argc!=2)
     {
-      std::cerr << "Call the program as mpirun -np num_proc xtrans input_file_name" << std::endl;
+      std::cerr << "Call the program as mpirun -np num_proc xtrans input_file_name" << std::endl
+      << "or as mpirun -np num_proc xtrans --batch case_list_file_name" << std::endl;
       return 1;
     }
     ParameterHandler prm;
@@ -0,0 +1,65 @@
+#include <deal.II/base/utilities.h>
+
+#include <iomanip>
+
+#include "../../include/common/memory_report.h"
+
+MemoryReport::MemoryReport (MPI_Comm mpi_communicator,
+                            const std::string &title)
+:
+mpi_communicator(mpi_communicator),
+title(title)
+{
+}
+
+MemoryReport::~MemoryReport ()
+{
+}
+
+void MemoryReport::add (const std::string &name, double bytes)
+{
+  rows.push_back (std::make_pair (name, bytes));
+}
+
+double MemoryReport::get_local_bytes () const
+{
+  double sum = 0.0;
+  for (unsigned int i=0; i<rows.size(); ++i)
+    sum += rows[i].second;
+  return sum;
+}
+
+void MemoryReport::print (std::ostream &out) const
+{
+  const bool is_root = (Utilities::MPI::this_mpi_process (mpi_communicator)==0);
+  const double mb = 1024.0 * 1024.0;
+  const std::streamsize precision = out.precision ();
+  if (is_root)
+    out << title << " [MB]" << std::endl
+    << std::setw(40) << std::left << "structure" << std::right
+    << std::setw(12) << "min/proc"
+    << std::setw(12) << "avg/proc"
+    << std::setw(12) << "max/proc"
+    << std::setw(14) << "total" << std::endl;
+
+  for (unsigned int i=0; i<=rows.size(); ++i)
+  {
+    const bool is_sum = (i==rows.size());
+    const double bytes = (is_sum ? get_local_bytes () : rows[i].second);
+    Utilities::MPI::MinMaxAvg stats = Utilities::MPI::min_max_avg (bytes / mb,
+                                                                   mpi_communicator);
+    if (is_root)
+      out << std::setw(40) << std::left
+      << (is_sum ? std::string ("sum") : rows[i].first) << std::right
+      << std::fixed << std::setprecision (1)
+      << std::setw(12) << stats.min
+      << std::setw(12) << stats.avg
+      << std::setw(12) << stats.max
+      << std::setw(14) << stats.sum << std::endl;
+  }
+  if (is_root)
+  {
+    out.unsetf (std::ios_base::floatfield);
+    out.precision (precision);
+  }
+}
@@ -6,7 +6,9 @@
 ModelManager::ModelManager (ParameterHandler &prm)
 :
 transport_model_name(prm.get("transport model")),
-dim(prm.get_integer("problem dimension"))
+dim(prm.get_integer("problem dimension")),
+is_dry_run(prm.get_bool("dry run")),
+is_plan_only(prm.get_bool("plan only"))
 {
   // register new methods here
   method_index["ep"] = 0;
@@ -29,12 +31,22 @@ void ModelManager::build_and_run_model (ParameterHandler &prm)
       if (dim==2)
       {
         std_cxx11::shared_ptr<TransportBase<2> > tb = std_cxx11::shared_ptr<TransportBase<2> > (new EvenParity<2>(prm));
-        tb->run ();
+        if (is_plan_only)
+          tb->plan_job (prm);
+        else if (is_dry_run)
+          tb->predict_memory ();
+        else
+          tb->run ();
       }
       else
       {
         std_cxx11::shared_ptr<TransportBase<3> > tb = std_cxx11::shared_ptr<TransportBase<3> > (new EvenParity<3>(prm));
-        tb->run ();
+        if (is_plan_only)
+          tb->plan_job (prm);
+        else if (is_dry_run)
+          tb->predict_memory ();
+        else
+          tb->run ();
       }
     }
       break;
@@ -5,6 +5,7 @@
 #include <iomanip>
 
 #include "../../include/common/problem_definition.h"
+#include "../../include/aqdata/aq_factory.h"
 
 using namespace dealii;
 
@@ -19,8 +20,10 @@ is_eigen_problem(prm.get_bool("do eigenvalue calculations")),
 do_nda(prm.get_bool("do NDA")),
 do_print_sn_quad(prm.get_bool("do print angular quadrature info")),
 have_reflective_bc(prm.get_bool("have reflective BC")),
+is_explicit_reflective(prm.get_bool("use explicit reflective boundary condition or not")),
 p_order(prm.get_integer("finite element polynomial degree")),
 global_refinements(prm.get_integer("uniform refinements")),
+is_mesh_generated(prm.get_bool("is mesh generated by deal.II")),
 output_namebase(prm.get("output file name base"))
 {
 }
@@ -41,8 +44,14 @@ void ProblemDefinition::declare_parameters (ParameterHandler &prm)
     prm.declare_entry ("preconditioner name", "amg", Patterns::Selection("amg|parasails|bjacobi|jacobi|bssor"), "precond names");
     prm.declare_entry ("ssor factor", "1.0", Patterns::Double (), "damping factor of Block SSOR");
     prm.declare_entry ("linear solver name", "cg", Patterns::Selection("cg|gmres|bicgstab|direct"), "solers");
-    prm.declare_entry ("angular quadrature name", "lsgc", Patterns::Selection ("lsgc"), "angular quadrature types. only LS-GC implemented for now.");
+    prm.declare_entry ("angular quadrature name", "lsgc", Patterns::Selection (get_aq_names ()), "angular quadrature types: lsgc (level-symmetric-like Gauss-Chebyshev), ls (level-symmetric LQn, orders 2-12), pglc (product Gauss-Legendre-Chebyshev), lebedev (orders 2-10, degree order+1)");
     prm.declare_entry ("angular quadrature order", "4", Patterns::Integer (), "Gauss-Chebyshev level-symmetric-like quadrature");
+    prm.declare_entry ("angular quadrature orders per group", "", Patterns::List (Patterns::Integer (2)), "SN order of every group; empty uses angular quadrature order for all groups. Groups with different orders always use group-major component ordering");
+    prm.declare_entry ("automatic angular orders", "false", Patterns::Bool (), "choose SN orders per group from the longest mean free path of each group relative to the other groups");
+    prm.declare_entry ("minimum angular quadrature order", "2", Patterns::Integer (2), "lowest SN order chosen by automatic angular orders");
+    prm.declare_entry ("angular multigrid levels", "0", Patterns::Integer (0), "coarse angular levels, each halving the SN orders down to S2, used to correct the scalar flux after every source iteration; 0 disables angular multigrid");
+    prm.declare_entry ("angular multigrid sweeps", "2", Patterns::Integer (1), "source iterations on each coarse angular level per correction");
+    prm.declare_entry ("component ordering", "direction-major", Patterns::Selection("direction-major|group-major"), "ordering of HO components: direction-major keeps groups of a direction adjacent, group-major keeps directions of a group adjacent");
     prm.declare_entry ("number of groups", "1", Patterns::Integer (), "Number of groups in MG calculations");
     prm.declare_entry ("spatial discretization", "cfem", Patterns::Selection("dfem|cfem"), "USE DFEM or CFEM for spatial discretization");
     prm.declare_entry ("do eigenvalue calculations", "false", Patterns::Bool(), "Boolean to determine problem type");
@@ -51,14 +60,43 @@ void ProblemDefinition::declare_parameters (ParameterHandler &prm)
     prm.declare_entry ("reflective boundary names", "", Patterns::List (Patterns::Anything ()), "must be lower cases of xmin,xmax,ymin,ymax,zmin,zmax");
     prm.declare_entry ("finite element polynomial degree", "1", Patterns::Integer(), "polynomial degree p for finite element");
     prm.declare_entry ("uniform refinements", "0", Patterns::Integer(), "number of uniform refinements desired");
+    prm.declare_entry ("pre-assembly shape class memory in MB", "64", Patterns::Double (0.0), "per processor memory for pre-assembled matrices of cell shapes shared by two or more cells; each class costs n_q*(n_dir+1)*dofs_per_cell^2 doubles, the most populated shapes are pre-assembled first");
+    prm.declare_entry ("full reassembly every n material updates", "50", Patterns::Integer (0), "material updates of a session patch the HO matrices by subtracting old and adding new local matrices; every N-th update reassembles them from scratch to drop accumulated round-off, 0 never does");
+    prm.declare_entry ("use direct matrix assembly", "true", Patterns::Bool (), "add local matrices through precomputed offsets into the PETSc value arrays instead of MatSetValues");
     prm.declare_entry ("x, y, z max values of boundary locations", "", Patterns::List (Patterns::Double ()), "xmax, ymax, zmax of the boundaries, mins are zero");
     prm.declare_entry ("number of cells for x, y, z directions", "", Patterns::List (Patterns::Integer ()), "Geotry is hyper rectangle defined by how many cells exist per direction");
     prm.declare_entry ("number of materials", "1", Patterns::Integer (), "must be a positive integer");
     prm.declare_entry ("do print angular quadrature info", "true", Patterns::Bool(), "Boolean to determine if printing angular quadrature information");
     prm.declare_entry ("is mesh generated by deal.II", "true", Patterns::Bool(), "Boolean to determine if generating mesh in dealii or read in mesh");
-    //prm.declare_entry ("use explicit reflective boundary condition or not", "true", Patterns::Bool(), "");
+    prm.declare_entry ("use explicit reflective boundary condition or not", "true", Patterns::Bool(), "EP only: true couples a direction to its reflection through the reflected derivative (nonsymmetric); false uses a symmetric penalty coupling with the partner lagged by one iteration so CG and symmetric AMG apply");
     prm.declare_entry ("output file name base", "solu", Patterns::Anything(), "name base of the output file");
+    prm.declare_entry ("dry run", "false", Patterns::Bool(), "build the coarse mesh only, print the predicted memory per processor of the HO/LO system and stop");
+    prm.declare_entry ("plan only", "false", Patterns::Bool(), "build the coarse mesh and quadrature only, print estimated sizes, memory, assembly work and source iteration times per processor count with a recommended processor and thread count, and stop");
+    prm.declare_entry ("machine profile file name", "", Patterns::Anything(), "machine profile written by xtrans-bench --profile for plan only; empty uses an uncalibrated default node");
+    prm.declare_entry ("planned linear iterations per HO solve", "20", Patterns::Integer (1), "Krylov iterations per HO solve assumed by plan only, e.g. from the linear_iterations of a telemetry stream");
+    prm.declare_entry ("maximum planned nodes", "64", Patterns::Integer (1), "largest node count considered by plan only");
+    prm.declare_entry ("telemetry file name", "", Patterns::Anything(), "JSON-lines file receiving one record per source iteration sweep and power iteration generation (schema in telemetry_stream.h); empty disables");
+    prm.declare_entry ("do profiling", "false", Patterns::Bool(), "time nested solver sections and HO component solves, reduced over processors and written to <output file name base>-profile.json at the end of the run");
     prm.declare_entry ("mesh file name", "mesh.msh", Patterns::Anything(), ".msh file name for read-in mesh");
+    prm.declare_entry ("mesh cache file name", "", Patterns::Anything(), "binary coarse mesh written after parsing the .msh file and read instead of it while newer; empty disables the cache");
+    prm.declare_entry ("gmsh tag kind", "physical", Patterns::Selection("physical|elementary"), "which Gmsh element tag sets material and boundary ids");
+    prm.declare_entry ("gmsh material tag map", "", Patterns::List(Patterns::Anything()), "tag:material pairs with 1-based materials, e.g. 1:1, 7:2; empty uses the tag as material number");
+    prm.declare_entry ("gmsh boundary tag map", "", Patterns::List(Patterns::Anything()), "tag:name pairs with names xmin, xmax, ymin, ymax, zmin, zmax; other boundary faces are vacuum");
+    prm.declare_entry ("load balancing", "none", Patterns::Selection("none|cost model|measured"), "weights for p4est partitioning: none counts cells, cost model weighs source cells and faces, measured uses assembly times and falls back to the cost model before the first assembly");
+    prm.declare_entry ("cost model cell weights", "300, 150, 250", Patterns::List (Patterns::Integer (0), 3, 3), "extra weights of a fissile or source cell, a boundary face and a DFEM interior face; every cell has a base weight of 1000");
+    prm.declare_entry ("adaptive refinement cycles", "0", Patterns::Integer (0), "number of solve-estimate-refine cycles after the first solve");
+    prm.declare_entry ("refinement fraction", "0.3", Patterns::Double (0.0, 1.0), "fraction of cells with the largest flux error indicators refined per cycle");
+    prm.declare_entry ("coarsening fraction", "0.03", Patterns::Double (0.0, 1.0), "fraction of cells with the smallest indicators coarsened per cycle");
+    prm.declare_entry ("output format", "vtu", Patterns::Selection("vtu|vtu-parallel|gnuplot|none"), "vtu: one piece per processor plus a pvtu record; vtu-parallel: one file written collectively with MPI-IO; gnuplot: one text file per processor; none: no output");
+    prm.declare_entry ("output compression", "best speed", Patterns::Selection("none|best speed|default|best compression"), "zlib compression level of VTU output");
+    prm.declare_entry ("output groups", "", Patterns::List (Patterns::Integer (1)), "groups whose scalar flux is written, numbered from 1; empty writes all groups");
+    prm.declare_entry ("output every n generations", "0", Patterns::Integer (0), "also write output every N power iterations; 0 writes only the converged solution");
+    prm.declare_entry ("output subdomain field", "false", Patterns::Bool(), "add the owning processor of each cell to the output");
+    prm.declare_entry ("write output in background", "false", Patterns::Bool(), "write per-processor vtu pieces on a background thread");
+    prm.declare_entry ("checkpoint interval", "0", Patterns::Integer (0), "write a checkpoint every N power iterations and after convergence; 0 disables checkpoints");
+    prm.declare_entry ("checkpoint file name base", "checkpoint", Patterns::Anything(), "checkpoints are written to <base>.mesh and <base>.state");
+    prm.declare_entry ("checkpoint angular fluxes", "false", Patterns::Bool(), "also checkpoint angular fluxes; they are only reused at the same refinement and quadrature");
+    prm.declare_entry ("restart from checkpoint", "false", Patterns::Bool(), "start from the checkpoint; more uniform refinements than the checkpoint interpolate it to the finer mesh");
   }
   // FixIt: for current deal.II code, we don't consider reading mesh
   
@@ -185,6 +223,11 @@ bool ProblemDefinition::get_print_sn_quad_bool ()
   return do_print_sn_quad;
 }
 
+bool ProblemDefinition::get_generated_mesh_bool ()
+{
+  return is_mesh_generated;
+}
+
 std::string ProblemDefinition::get_transport_model ()
 {
   return transport_model_name;
@@ -205,6 +248,11 @@ bool ProblemDefinition::get_reflective_bool ()
   return have_reflective_bc;
 }
 
+bool ProblemDefinition::get_explicit_reflective_bool ()
+{
+  return is_explicit_reflective;
+}
+
 bool ProblemDefinition::get_eigen_problem_bool ()
 {
   return is_eigen_problem;
@@ -0,0 +1,187 @@
+#include <deal.II/base/utilities.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "../../include/common/profiler.h"
+
+Profiler::Section::Section ()
+:
+calls(0),
+wall_time(0.0)
+{
+}
+
+Profiler::Profiler (MPI_Comm mpi_communicator, bool enabled)
+:
+mpi_communicator(mpi_communicator),
+enabled(enabled)
+{
+}
+
+Profiler::~Profiler ()
+{
+}
+
+Profiler::Scope::Scope (Profiler &profiler, const char *name)
+:
+profiler(profiler),
+active(profiler.is_enabled ())
+{
+  if (active)
+    profiler.enter (name);
+}
+
+Profiler::Scope::~Scope ()
+{
+  if (active)
+    profiler.leave ();
+}
+
+bool Profiler::is_enabled () const
+{
+  return enabled;
+}
+
+void Profiler::enter (const std::string &name)
+{
+  const std::string path = (open_sections.size()==0 ? name :
+                            open_sections.back().first + "/" + name);
+  open_sections.push_back (std::make_pair (path, MPI_Wtime ()));
+}
+
+void Profiler::leave ()
+{
+  AssertThrow (open_sections.size()>0,
+               ExcMessage("leaving a profiler section that was never entered"));
+  Section &section = sections[open_sections.back().first];
+  section.calls += 1;
+  section.wall_time += MPI_Wtime () - open_sections.back().second;
+  open_sections.pop_back ();
+}
+
+void Profiler::add_component_solve (unsigned int k,
+                                    double wall_time,
+                                    unsigned int iterations)
+{
+  if (!enabled)
+    return;
+  if (k>=component_solves.size())
+  {
+    component_solves.resize (k+1);
+    component_iterations.resize (k+1, 0);
+  }
+  component_solves[k].calls += 1;
+  component_solves[k].wall_time += wall_time;
+  component_iterations[k] += iterations;
+}
+
+// Processors may not have entered the same sections (e.g. one without
+// reflective faces), so the reductions run over the union of all names.
+std::vector<std::string> Profiler::get_global_section_names ()
+{
+  std::string local_names;
+  for (auto it=sections.begin(); it!=sections.end(); ++it)
+    local_names += it->first + "\n";
+
+  const unsigned int n_procs = Utilities::MPI::n_mpi_processes (mpi_communicator);
+  const unsigned int this_proc = Utilities::MPI::this_mpi_process (mpi_communicator);
+  int local_size = local_names.size ();
+  std::vector<int> sizes (n_procs), displacements (n_procs, 0);
+  MPI_Gather (&local_size, 1, MPI_INT, &sizes[0], 1, MPI_INT, 0, mpi_communicator);
+  for (unsigned int p=1; p<n_procs; ++p)
+    displacements[p] = displacements[p-1] + sizes[p-1];
+  std::vector<char> all_names (std::max (1, displacements[n_procs-1] + sizes[n_procs-1]));
+  MPI_Gatherv (const_cast<char *>(local_names.data ()), local_size, MPI_CHAR,
+               &all_names[0], &sizes[0], &displacements[0], MPI_CHAR,
+               0, mpi_communicator);
+
+  std::string merged;
+  if (this_proc==0)
+  {
+    std::set<std::string> names;
+    std::istringstream is (std::string (all_names.begin(),
+                                        all_names.begin() + displacements[n_procs-1] + sizes[n_procs-1]));
+    std::string name;
+    while (std::getline (is, name))
+      names.insert (name);
+    for (auto it=names.begin(); it!=names.end(); ++it)
+      merged += *it + "\n";
+  }
+  int merged_size = merged.size ();
+  MPI_Bcast (&merged_size, 1, MPI_INT, 0, mpi_communicator);
+  merged.resize (merged_size);
+  if (merged_size>0)
+    MPI_Bcast (&merged[0], merged_size, MPI_CHAR, 0, mpi_communicator);
+
+  std::vector<std::string> names;
+  std::istringstream is (merged);
+  std::string name;
+  while (std::getline (is, name))
+    names.push_back (name);
+  return names;
+}
+
+void Profiler::write_json (const std::string &filename)
+{
+  if (!enabled)
+    return;
+  const std::vector<std::string> names = get_global_section_names ();
+  const unsigned int n_procs = Utilities::MPI::n_mpi_processes (mpi_communicator);
+
+  std::ostringstream os;
+  os << std::setprecision (6);
+  os << "{\n  \"n_processes\": " << n_procs << ",\n  \"sections\": [";
+  for (unsigned int i=0; i<names.size(); ++i)
+  {
+    const Section &section = sections[names[i]];
+    // exclusive time: minus that of the direct children
+    const std::string prefix = names[i] + "/";
+    double self_time = section.wall_time;
+    for (unsigned int j=0; j<names.size(); ++j)
+      if (names[j].compare (0, prefix.size(), prefix)==0 &&
+          names[j].find ('/', prefix.size())==std::string::npos)
+        self_time -= sections[names[j]].wall_time;
+
+    const Utilities::MPI::MinMaxAvg wall =
+    Utilities::MPI::min_max_avg (section.wall_time, mpi_communicator);
+    const Utilities::MPI::MinMaxAvg self =
+    Utilities::MPI::min_max_avg (self_time, mpi_communicator);
+    const double calls = Utilities::MPI::max (static_cast<double>(section.calls),
+                                              mpi_communicator);
+    os << (i==0 ? "\n" : ",\n")
+    << "    {\"name\": \"" << names[i] << "\""
+    << ", \"calls\": " << static_cast<unsigned long>(calls)
+    << ", \"wall_min\": " << wall.min
+    << ", \"wall_max\": " << wall.max
+    << ", \"wall_avg\": " << wall.avg
+    << ", \"self_avg\": " << self.avg
+    << ", \"max_rank\": " << wall.max_index << "}";
+  }
+  os << "\n  ],\n  \"components\": [";
+  // every processor takes part in every component solve
+  for (unsigned int k=0; k<component_solves.size(); ++k)
+  {
+    const Utilities::MPI::MinMaxAvg wall =
+    Utilities::MPI::min_max_avg (component_solves[k].wall_time, mpi_communicator);
+    os << (k==0 ? "\n" : ",\n")
+    << "    {\"component\": " << k
+    << ", \"solves\": " << component_solves[k].calls
+    << ", \"iterations\": " << component_iterations[k]
+    << ", \"wall_min\": " << wall.min
+    << ", \"wall_max\": " << wall.max
+    << ", \"wall_avg\": " << wall.avg << "}";
+  }
+  os << "\n  ]\n}\n";
+
+  if (Utilities::MPI::this_mpi_process (mpi_communicator)==0)
+  {
+    std::ofstream out (filename.c_str ());
+    AssertThrow (out.good (),
+                 ExcMessage("cannot open profiling file " + filename));
+    out << os.str ();
+  }
+}
@@ -0,0 +1,114 @@
+#include <deal.II/base/utilities.h>
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "../../include/common/telemetry_stream.h"
+
+TelemetryStream::Record::Record ()
+{
+}
+
+void TelemetryStream::Record::add_key (const std::string &key)
+{
+  text += (text.empty () ? "\"" : ", \"") + key + "\": ";
+}
+
+std::string TelemetryStream::Record::format_number (double value)
+{
+  if (!std::isfinite (value))
+    return "null";
+  std::ostringstream os;
+  os << std::setprecision (10) << value;
+  return os.str ();
+}
+
+void TelemetryStream::Record::add (const std::string &key, const std::string &value)
+{
+  add_key (key);
+  text += "\"" + value + "\"";
+}
+
+void TelemetryStream::Record::add (const std::string &key, double value)
+{
+  add_key (key);
+  text += format_number (value);
+}
+
+void TelemetryStream::Record::add (const std::string &key, unsigned int value)
+{
+  add_key (key);
+  text += Utilities::int_to_string (value);
+}
+
+void TelemetryStream::Record::add (const std::string &key,
+                                   const std::vector<double> &values)
+{
+  add_key (key);
+  text += "[";
+  for (unsigned int i=0; i<values.size(); ++i)
+    text += (i==0 ? "" : ", ") + format_number (values[i]);
+  text += "]";
+}
+
+void TelemetryStream::Record::add (const std::string &key,
+                                   const std::vector<unsigned int> &values)
+{
+  add_key (key);
+  text += "[";
+  for (unsigned int i=0; i<values.size(); ++i)
+    text += (i==0 ? "" : ", ") + Utilities::int_to_string (values[i]);
+  text += "]";
+}
+
+std::string TelemetryStream::Record::str () const
+{
+  return "{" + text + "}";
+}
+
+TelemetryStream::TelemetryStream (MPI_Comm mpi_communicator,
+                                  const std::string &filename)
+:
+mpi_communicator(mpi_communicator),
+enabled(filename!=""),
+start_time(MPI_Wtime ())
+{
+  if (enabled && Utilities::MPI::this_mpi_process (mpi_communicator)==0)
+  {
+    out.open (filename.c_str ());
+    AssertThrow (out.good (),
+                 ExcMessage("cannot open telemetry file " + filename));
+  }
+}
+
+TelemetryStream::~TelemetryStream ()
+{
+}
+
+bool TelemetryStream::is_enabled () const
+{
+  return enabled;
+}
+
+TelemetryStream::Record TelemetryStream::begin_record (const std::string &event)
+{
+  Record record;
+  record.add ("schema", std::string ("xtrans-telemetry/1"));
+  record.add ("event", event);
+  record.add ("wall_time", MPI_Wtime () - start_time);
+  return record;
+}
+
+void TelemetryStream::write_record (Record &record)
+{
+  if (!enabled)
+    return;
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats (stats);
+  const double hwm_mb = stats.VmHWM / 1024.0;
+  record.add ("memory_hwm_mb_max", Utilities::MPI::max (hwm_mb, mpi_communicator));
+  record.add ("memory_hwm_mb_total", Utilities::MPI::sum (hwm_mb, mpi_communicator));
+  if (Utilities::MPI::this_mpi_process (mpi_communicator)==0)
+    out << record.str () << std::endl;
+}
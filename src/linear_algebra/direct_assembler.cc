@@ -0,0 +1,159 @@
+#include <deal.II/lac/exceptions.h>
+
+#include <algorithm>
+
+#include "../../include/linear_algebra/direct_assembler.h"
+
+DirectAssembler::DirectAssembler ()
+:
+row_start(0),
+row_end(0),
+col_start(0),
+col_end(0),
+n_diag_nonzeros(0)
+{
+}
+
+DirectAssembler::~DirectAssembler ()
+{
+}
+
+void DirectAssembler::initialize
+(const PETScWrappers::MPI::SparseMatrix &pattern_matrix)
+{
+  Mat mat = pattern_matrix;
+  PetscBool is_mpiaij;
+  PetscErrorCode ierr = PetscObjectTypeCompare ((PetscObject)mat, MATMPIAIJ, &is_mpiaij);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  AssertThrow (is_mpiaij,
+               ExcMessage("direct assembly requires MPIAIJ matrices"));
+  
+  ierr = MatGetOwnershipRange (mat, &row_start, &row_end);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  ierr = MatGetOwnershipRangeColumn (mat, &col_start, &col_end);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  Mat diag, offd;
+  const PetscInt *colmap;
+  ierr = MatMPIAIJGetSeqAIJ (mat, &diag, &offd, &colmap);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  PetscInt n_rows;
+  const PetscInt *ia, *ja;
+  PetscBool done;
+  
+  // diagonal block: columns are local to the owned column range
+  ierr = MatGetRowIJ (diag, 0, PETSC_FALSE, PETSC_FALSE, &n_rows, &ia, &ja, &done);
+  AssertThrow (ierr==0 && done, ExcMessage("cannot access CSR structure of diagonal block"));
+  diag_row_ptr.assign (ia, ia+n_rows+1);
+  diag_cols.assign (ja, ja+ia[n_rows]);
+  n_diag_nonzeros = ia[n_rows];
+  ierr = MatRestoreRowIJ (diag, 0, PETSC_FALSE, PETSC_FALSE, &n_rows, &ia, &ja, &done);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  // off-diagonal block: compressed columns are translated to global ones,
+  // which keeps them sorted since colmap is ascending
+  ierr = MatGetRowIJ (offd, 0, PETSC_FALSE, PETSC_FALSE, &n_rows, &ia, &ja, &done);
+  AssertThrow (ierr==0 && done, ExcMessage("cannot access CSR structure of off-diagonal block"));
+  offd_row_ptr.assign (ia, ia+n_rows+1);
+  offd_global_cols.resize (ia[n_rows]);
+  for (PetscInt i=0; i<ia[n_rows]; ++i)
+    offd_global_cols[i] = colmap[ja[i]];
+  ierr = MatRestoreRowIJ (offd, 0, PETSC_FALSE, PETSC_FALSE, &n_rows, &ia, &ja, &done);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+}
+
+void DirectAssembler::release_pattern ()
+{
+  std::vector<PetscInt>().swap (diag_row_ptr);
+  std::vector<PetscInt>().swap (diag_cols);
+  std::vector<PetscInt>().swap (offd_row_ptr);
+  std::vector<PetscInt>().swap (offd_global_cols);
+}
+
+void DirectAssembler::compute_offsets
+(const std::vector<types::global_dof_index> &rows,
+ const std::vector<types::global_dof_index> &cols,
+ std::vector<PetscInt> &offsets) const
+{
+  AssertThrow (diag_row_ptr.size()>0,
+               ExcMessage("offsets need the pattern: call initialize first"));
+  offsets.resize (rows.size() * cols.size());
+  for (unsigned int i=0; i<rows.size(); ++i)
+  {
+    const PetscInt row = rows[i];
+    for (unsigned int j=0; j<cols.size(); ++j)
+    {
+      PetscInt &offset = offsets[i*cols.size()+j];
+      offset = -1;
+      if (row<row_start || row>=row_end)
+        continue;
+      const PetscInt lr = row - row_start;
+      const PetscInt col = cols[j];
+      if (col>=col_start && col<col_end)
+      {
+        const PetscInt *begin = &diag_cols[0] + diag_row_ptr[lr];
+        const PetscInt *end = &diag_cols[0] + diag_row_ptr[lr+1];
+        const PetscInt *pos = std::lower_bound (begin, end, col - col_start);
+        if (pos!=end && *pos==col-col_start)
+          offset = pos - &diag_cols[0];
+      }
+      else if (offd_global_cols.size()>0)
+      {
+        const PetscInt *begin = &offd_global_cols[0] + offd_row_ptr[lr];
+        const PetscInt *end = &offd_global_cols[0] + offd_row_ptr[lr+1];
+        const PetscInt *pos = std::lower_bound (begin, end, col);
+        if (pos!=end && *pos==col)
+          offset = n_diag_nonzeros + (pos - &offd_global_cols[0]);
+      }
+    }
+  }
+}
+
+void DirectAssembler::add
+(PETScWrappers::MPI::SparseMatrix &matrix,
+ const std::vector<PetscInt> &offsets,
+ const std::vector<types::global_dof_index> &rows,
+ const std::vector<types::global_dof_index> &cols,
+ const FullMatrix<double> &local_matrix,
+ const double factor) const
+{
+  Mat mat = matrix;
+  Mat diag, offd;
+  const PetscInt *colmap;
+  PetscScalar *diag_values, *offd_values;
+  PetscErrorCode ierr = MatMPIAIJGetSeqAIJ (mat, &diag, &offd, &colmap);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  ierr = MatSeqAIJGetArray (diag, &diag_values);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  ierr = MatSeqAIJGetArray (offd, &offd_values);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  const unsigned int n_cols = cols.size ();
+  for (unsigned int i=0; i<rows.size(); ++i)
+    for (unsigned int j=0; j<n_cols; ++j)
+    {
+      const PetscInt offset = offsets[i*n_cols+j];
+      const PetscScalar value = factor * local_matrix(i,j);
+      if (offset>=0)
+      {
+        if (offset<n_diag_nonzeros)
+          diag_values[offset] += value;
+        else
+          offd_values[offset-n_diag_nonzeros] += value;
+      }
+      else if (value!=0.0)
+      {
+        // rows of other processors are stashed by PETSc until compress()
+        const PetscInt row = rows[i];
+        const PetscInt col = cols[j];
+        ierr = MatSetValues (mat, 1, &row, 1, &col, &value, ADD_VALUES);
+        AssertThrow (ierr==0, ExcPETScError(ierr));
+      }
+    }
+  
+  ierr = MatSeqAIJRestoreArray (offd, &offd_values);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  ierr = MatSeqAIJRestoreArray (diag, &diag_values);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+}
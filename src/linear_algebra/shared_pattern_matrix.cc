@@ -0,0 +1,50 @@
+#include <deal.II/lac/exceptions.h>
+
+#include "../../include/linear_algebra/shared_pattern_matrix.h"
+
+SharedPatternMatrix::SharedPatternMatrix ()
+:
+PETScWrappers::MPI::SparseMatrix (),
+is_shared(false)
+{
+}
+
+SharedPatternMatrix::~SharedPatternMatrix ()
+{
+}
+
+void SharedPatternMatrix::reinit_with_shared_pattern
+(const PETScWrappers::MPI::SparseMatrix &pattern_owner)
+{
+  // set up the base class through its own reinit on the owner's layout and
+  // communicator, without preallocation, before swapping the PETSc object
+  PetscInt local_rows, local_columns;
+  PetscErrorCode ierr = MatGetLocalSize (pattern_owner, &local_rows, &local_columns);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  reinit (pattern_owner.get_mpi_communicator (),
+          pattern_owner.m (), pattern_owner.n (),
+          local_rows, local_columns, 0);
+  
+  ierr = MatDestroy (&matrix);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  // For (MPI)AIJ matrices PETSc hands the row offsets and column indices of
+  // the diagonal and off-diagonal blocks to the duplicate and allocates a
+  // zeroed value array only
+  ierr = MatDuplicate (pattern_owner, MAT_SHARE_NONZERO_PATTERN, &matrix);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  
+  is_shared = true;
+  last_action = VectorOperation::unknown;
+}
+
+std::size_t SharedPatternMatrix::memory_consumption () const
+{
+  if (!is_shared)
+    return PETScWrappers::MPI::SparseMatrix::memory_consumption ();
+  
+  MatInfo info;
+  PetscErrorCode ierr = MatGetInfo (matrix, MAT_LOCAL, &info);
+  AssertThrow (ierr==0, ExcPETScError(ierr));
+  return sizeof (*this) + static_cast<std::size_t>(info.nz_allocated) * sizeof (PetscScalar);
+}
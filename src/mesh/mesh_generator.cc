@@ -1,13 +1,68 @@
+#include <deal.II/base/mpi.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_tools.h>
 #include <deal.II/grid/tria_accessor.h>
 #include <deal.II/grid/tria_iterator.h>
 #include <deal.II/grid/grid_in.h>
+#include <deal.II/grid/grid_reordering.h>
 
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <sstream>
 
 #include "../../include/mesh/mesh_generator.h"
 
+namespace
+{
+  const std::map<std::string, unsigned int> bd_names_to_id
+  {{"xmin",0}, {"xmax",1}, {"ymin",2}, {"ymax",3}, {"zmin",4}, {"zmax",5}};
+
+  // Boundary faces of a read-in mesh that carry no mapped tag are vacuum.
+  const unsigned int vacuum_boundary_id = 6;
+
+  template <typename T>
+  void pack (const T &value, std::vector<char> &buffer)
+  {
+    const char *p = reinterpret_cast<const char*>(&value);
+    buffer.insert (buffer.end(), p, p+sizeof(T));
+  }
+
+  template <typename T>
+  T unpack (const std::vector<char> &buffer, std::size_t &pos)
+  {
+    AssertThrow (pos+sizeof(T)<=buffer.size(),
+                 ExcMessage("truncated coarse mesh buffer"));
+    T value;
+    std::memcpy (&value, &buffer[pos], sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  // First bytes of a coarse mesh cache; the hash of the tag settings the
+  // cached ids were mapped with follows.
+  const char cache_magic[] = "xtrans-gmsh-cache";
+
+  // FNV-1a: unlike std::hash it is the same for every build reading the cache
+  unsigned long long fnv1a_hash (const std::string &s)
+  {
+    unsigned long long h = 14695981039346656037ULL;
+    for (unsigned int i=0; i<s.size(); ++i)
+      h = (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ULL;
+    return h;
+  }
+
+  bool is_newer (const std::string &file, const std::string &reference)
+  {
+    struct stat a, b;
+    if (stat(file.c_str(), &a)!=0 || stat(reference.c_str(), &b)!=0)
+      return false;
+    return a.st_mtime>=b.st_mtime;
+  }
+}
+
 template <int dim>
 MeshGenerator<dim>::MeshGenerator (ParameterHandler &prm)
 :
@@ -16,7 +71,12 @@ have_reflective_bc(prm.get_bool("have reflective BC")),
 global_refinements(prm.get_integer("uniform refinements"))
 {
   if (!is_mesh_generated)
+  {
     mesh_filename = prm.get ("mesh file name");
+    mesh_cache_filename = prm.get ("mesh cache file name");
+    process_gmsh_tag_maps (prm);
+    preprocess_reflective_bc (prm);
+  }
   else
   {
     process_coordinate_information (prm);
@@ -33,20 +93,400 @@ MeshGenerator<dim>::~MeshGenerator ()
 template <int dim>
 void MeshGenerator<dim>::make_grid
 (parallel::distributed::Triangulation<dim> &tria)
+{
+  make_coarse_grid (tria);
+  tria.refine_global (global_refinements);
+}
+
+// The coarse mesh with material and boundary ids but no refinement. This is
+// also what Triangulation::load expects before restoring a saved mesh.
+template <int dim>
+void MeshGenerator<dim>::make_coarse_grid
+(parallel::distributed::Triangulation<dim> &tria)
 {
   if (is_mesh_generated)
   {
     generate_initial_grid (tria);
     initialize_material_id (tria);
     setup_boundary_ids (tria);
-    tria.refine_global (global_refinements);
   }
   else
+    read_gmsh_coarse_grid (tria);
+}
+
+// Tag maps from Gmsh tags to the ids the solver uses. Materials are entered
+// with the same 1-based numbering as the material ID map; boundaries use the
+// names of the generated meshes so reflective BCs work the same way.
+template <int dim>
+void MeshGenerator<dim>::process_gmsh_tag_maps (ParameterHandler &prm)
+{
+  use_elementary_tags = (prm.get ("gmsh tag kind")=="elementary");
+  std::vector<std::string> strings =
+  Utilities::split_string_list (prm.get ("gmsh material tag map"));
+  for (unsigned int i=0; i<strings.size(); ++i)
+  {
+    std::vector<std::string> pair = Utilities::split_string_list (strings[i], ':');
+    AssertThrow (pair.size()==2,
+                 ExcMessage("gmsh material tag map entries have the form tag:material"));
+    const int material = Utilities::string_to_int (pair[1]);
+    AssertThrow (material>0,
+                 ExcMessage("materials in gmsh material tag map start from 1"));
+    gmsh_tag_to_material_id[Utilities::string_to_int (pair[0])] = material - 1;
+  }
+  strings = Utilities::split_string_list (prm.get ("gmsh boundary tag map"));
+  for (unsigned int i=0; i<strings.size(); ++i)
+  {
+    std::vector<std::string> pair = Utilities::split_string_list (strings[i], ':');
+    AssertThrow (pair.size()==2,
+                 ExcMessage("gmsh boundary tag map entries have the form tag:name"));
+    AssertThrow (bd_names_to_id.find(pair[1])!=bd_names_to_id.end(),
+                 ExcMessage("Invalid boundary name in gmsh boundary tag map: use xmin, xmax, etc."));
+    gmsh_tag_to_boundary_id[Utilities::string_to_int (pair[0])] =
+    bd_names_to_id.at(pair[1]);
+  }
+}
+
+// Hash of the tag kind and both tag maps after parsing, so equivalent
+// spellings of a map give the same cache.
+template <int dim>
+unsigned long long MeshGenerator<dim>::gmsh_tag_map_hash () const
+{
+  std::ostringstream os;
+  os << (use_elementary_tags ? "elementary" : "physical") << ";materials";
+  for (std::map<unsigned int, unsigned int>::const_iterator
+       it=gmsh_tag_to_material_id.begin(); it!=gmsh_tag_to_material_id.end(); ++it)
+    os << " " << it->first << ":" << it->second;
+  os << ";boundaries";
+  for (std::map<unsigned int, unsigned int>::const_iterator
+       it=gmsh_tag_to_boundary_id.begin(); it!=gmsh_tag_to_boundary_id.end(); ++it)
+    os << " " << it->first << ":" << it->second;
+  return fnv1a_hash (os.str ());
+}
+
+// Only rank 0 touches the .msh file (or its cache). The coarse mesh goes to
+// the other ranks as one binary buffer, so startup does not hit the file
+// system from every rank and the text is parsed once.
+template <int dim>
+void MeshGenerator<dim>::read_gmsh_coarse_grid
+(parallel::distributed::Triangulation<dim> &tria)
+{
+  const MPI_Comm comm = tria.get_communicator ();
+  std::vector<char> buffer;
+  // rank 0 reports a failed read or parse to everyone before the mesh is
+  // sent, so the other ranks throw too instead of waiting in MPI_Bcast
+  std::string error;
+  if (Utilities::MPI::this_mpi_process (comm)==0)
+  {
+    try
+    {
+      const unsigned long long tag_hash = gmsh_tag_map_hash ();
+      const std::size_t header_size = sizeof(cache_magic) + sizeof(tag_hash);
+      bool cache_valid = false;
+      if (mesh_cache_filename!="" &&
+          is_newer (mesh_cache_filename, mesh_filename))
+      {
+        std::ifstream in (mesh_cache_filename.c_str(), std::ios::binary);
+        buffer.assign (std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+        // the cache stores mapped ids: reuse it only if the tag kind and
+        // the tag maps are the ones it was written with
+        std::size_t pos = sizeof(cache_magic);
+        cache_valid = (buffer.size()>=header_size &&
+                       std::memcmp (&buffer[0], cache_magic,
+                                    sizeof(cache_magic))==0 &&
+                       unpack<unsigned long long>(buffer, pos)==tag_hash);
+        if (cache_valid)
+          buffer.erase (buffer.begin(), buffer.begin()+header_size);
+        else
+          buffer.clear ();
+      }
+      if (!cache_valid)
+      {
+        parse_gmsh_file (buffer);
+        if (mesh_cache_filename!="")
+        {
+          std::ofstream out (mesh_cache_filename.c_str(), std::ios::binary);
+          out.write (cache_magic, sizeof(cache_magic));
+          out.write (reinterpret_cast<const char*>(&tag_hash), sizeof(tag_hash));
+          out.write (&buffer[0], buffer.size());
+        }
+      }
+    }
+    catch (std::exception &exc)
+    {
+      error = exc.what ();
+      if (error=="")
+        error = "reading " + mesh_filename + " failed";
+      buffer.clear ();
+    }
+  }
+
+  unsigned long long error_size = error.size ();
+  MPI_Bcast (&error_size, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  if (error_size>0)
+  {
+    error.resize (error_size);
+    MPI_Bcast (&error[0], static_cast<int>(error_size), MPI_CHAR, 0, comm);
+    AssertThrow (false, ExcMessage(error));
+  }
+
+  unsigned long long size = buffer.size ();
+  MPI_Bcast (&size, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  buffer.resize (size);
+  // MPI counts are int: send large meshes in chunks
+  const unsigned long long chunk = 1ULL << 30;
+  for (unsigned long long offset=0; offset<size; offset+=chunk)
+    MPI_Bcast (&buffer[offset], static_cast<int>(std::min(chunk, size-offset)),
+               MPI_CHAR, 0, comm);
+
+  std::size_t pos = 0;
+  AssertThrow (unpack<unsigned int>(buffer, pos)==dim,
+               ExcMessage("coarse mesh buffer has the wrong dimension"));
+  const unsigned int n_vertices = unpack<unsigned int>(buffer, pos);
+  const unsigned int n_cells = unpack<unsigned int>(buffer, pos);
+  const unsigned int n_faces = unpack<unsigned int>(buffer, pos);
+
+  std::vector<Point<dim> > vertices (n_vertices);
+  for (unsigned int i=0; i<n_vertices; ++i)
+    for (unsigned int d=0; d<dim; ++d)
+      vertices[i][d] = unpack<double>(buffer, pos);
+
+  std::vector<CellData<dim> > cells (n_cells);
+  for (unsigned int i=0; i<n_cells; ++i)
+  {
+    for (unsigned int v=0; v<GeometryInfo<dim>::vertices_per_cell; ++v)
+      cells[i].vertices[v] = unpack<unsigned int>(buffer, pos);
+    cells[i].material_id = unpack<unsigned int>(buffer, pos);
+  }
+
+  SubCellData subcelldata;
+  for (unsigned int i=0; i<n_faces; ++i)
+  {
+    if (dim==2)
+    {
+      CellData<1> face;
+      for (unsigned int v=0; v<2; ++v)
+        face.vertices[v] = unpack<unsigned int>(buffer, pos);
+      face.boundary_id = unpack<unsigned int>(buffer, pos);
+      subcelldata.boundary_lines.push_back (face);
+    }
+    else
+    {
+      CellData<2> face;
+      for (unsigned int v=0; v<4; ++v)
+        face.vertices[v] = unpack<unsigned int>(buffer, pos);
+      face.boundary_id = unpack<unsigned int>(buffer, pos);
+      subcelldata.boundary_quads.push_back (face);
+    }
+  }
+
+  // same vertex numbering as GridIn::read_msh hands to the triangulation
+  tria.create_triangulation_compatibility (vertices, cells, subcelldata);
+}
+
+// Reads an ASCII Gmsh 2.x file with quadrilaterals (2D) or hexahedra (3D)
+// and packs the coarse mesh for broadcasting. Boundary faces the file does
+// not list, or lists with an unmapped tag, are marked vacuum.
+template <int dim>
+void MeshGenerator<dim>::parse_gmsh_file (std::vector<char> &buffer)
+{
+  std::ifstream in (mesh_filename.c_str());
+  AssertThrow (in.good(),
+               ExcMessage("cannot open mesh file " + mesh_filename));
+  std::string line;
+  in >> line;
+  AssertThrow (line=="$MeshFormat",
+               ExcMessage(mesh_filename + " is not a Gmsh file"));
+  double version;
+  int file_type, data_size;
+  in >> version >> file_type >> data_size;
+  AssertThrow (version>=2.0 && version<3.0 && file_type==0,
+               ExcMessage("only ASCII Gmsh format 2 files are supported"));
+
+  while (in >> line && line!="$Nodes") {}
+  unsigned int n_nodes;
+  in >> n_nodes;
+  std::vector<Point<dim> > vertices (n_nodes);
+  std::map<unsigned int, unsigned int> node_to_vertex;
+  for (unsigned int i=0; i<n_nodes; ++i)
+  {
+    unsigned int id;
+    double x[3];
+    in >> id >> x[0] >> x[1] >> x[2];
+    for (unsigned int d=0; d<dim; ++d)
+      vertices[i][d] = x[d];
+    node_to_vertex[id] = i;
+  }
+
+  while (in >> line && line!="$Elements") {}
+  AssertThrow (line=="$Elements",
+               ExcMessage("no $Elements section in " + mesh_filename));
+  unsigned int n_elements;
+  in >> n_elements;
+  // Gmsh element types: 15 point, 1 line, 3 quadrilateral, 5 hexahedron
+  const unsigned int cell_type = (dim==2 ? 3 : 5);
+  const unsigned int face_type = (dim==2 ? 1 : 3);
+  std::map<unsigned int, unsigned int> type_to_n_nodes
+  {{15,1}, {1,2}, {3,4}, {5,8}};
+
+  std::vector<CellData<dim> > cells;
+  SubCellData subcelldata;
+  for (unsigned int i=0; i<n_elements; ++i)
+  {
+    unsigned int id, type, n_tags;
+    in >> id >> type >> n_tags;
+    AssertThrow (type_to_n_nodes.count (type),
+                 ExcMessage("unsupported Gmsh element type " + Utilities::int_to_string (type) +
+                            ": only quadrilateral/hexahedral meshes can be read"));
+    std::vector<unsigned int> tags (n_tags);
+    for (unsigned int t=0; t<n_tags; ++t)
+      in >> tags[t];
+    std::vector<unsigned int> nodes (type_to_n_nodes[type]);
+    for (unsigned int v=0; v<nodes.size(); ++v)
+    {
+      unsigned int node;
+      in >> node;
+      AssertThrow (node_to_vertex.count (node),
+                   ExcMessage("element refers to an unknown node"));
+      nodes[v] = node_to_vertex[node];
+    }
+    const unsigned int tag_index = (use_elementary_tags ? 1 : 0);
+    const unsigned int tag = (tag_index<n_tags ? tags[tag_index] : 0);
+
+    if (type==cell_type)
+    {
+      CellData<dim> cell;
+      for (unsigned int v=0; v<nodes.size(); ++v)
+        cell.vertices[v] = nodes[v];
+      if (gmsh_tag_to_material_id.empty ())
+      {
+        AssertThrow (tag>0,
+                     ExcMessage("cell without Gmsh tag: enter gmsh material tag map or tag kind"));
+        cell.material_id = tag - 1;
+      }
+      else
+      {
+        AssertThrow (gmsh_tag_to_material_id.count (tag),
+                     ExcMessage("Gmsh tag " + Utilities::int_to_string (tag) +
+                                " is not in gmsh material tag map"));
+        cell.material_id = gmsh_tag_to_material_id[tag];
+      }
+      cells.push_back (cell);
+    }
+    else if (type==face_type && gmsh_tag_to_boundary_id.count (tag))
+    {
+      if (dim==2)
+      {
+        CellData<1> face;
+        for (unsigned int v=0; v<2; ++v)
+          face.vertices[v] = nodes[v];
+        face.boundary_id = gmsh_tag_to_boundary_id[tag];
+        subcelldata.boundary_lines.push_back (face);
+      }
+      else
+      {
+        CellData<2> face;
+        for (unsigned int v=0; v<4; ++v)
+          face.vertices[v] = nodes[v];
+        face.boundary_id = gmsh_tag_to_boundary_id[tag];
+        subcelldata.boundary_quads.push_back (face);
+      }
+    }
+  }
+  AssertThrow (cells.size()>0,
+               ExcMessage("no quadrilateral/hexahedral cells in " + mesh_filename));
+
+  // Gmsh numbers vertices counterclockwise, deal.II's old-style numbering.
+  // Cells and faces stay in that numbering, as in GridIn::read_msh, and are
+  // converted by create_triangulation_compatibility.
+  GridTools::delete_unused_vertices (vertices, cells, subcelldata);
+  GridReordering<dim>::invert_all_cells_of_negative_grid (vertices, cells);
+  GridReordering<dim>::reorder_cells (cells);
+
+  // Faces seen by exactly one cell are on the boundary. Those without a
+  // mapped tag get the vacuum id; otherwise deal.II would default them to 0,
+  // which is xmin and may be reflective.
+  const unsigned int n_face_vertices = GeometryInfo<dim>::vertices_per_face;
+  // lexicographic vertex index to counterclockwise one, and back
+  const unsigned int to_gmsh[8] = {0, 1, 3, 2, 4, 5, 7, 6};
+  std::set<std::vector<unsigned int> > tagged_faces;
+  for (unsigned int i=0; i<subcelldata.boundary_lines.size(); ++i)
+  {
+    std::vector<unsigned int> key (subcelldata.boundary_lines[i].vertices,
+                                   subcelldata.boundary_lines[i].vertices+2);
+    std::sort (key.begin(), key.end());
+    tagged_faces.insert (key);
+  }
+  for (unsigned int i=0; i<subcelldata.boundary_quads.size(); ++i)
   {
-    GridIn<dim> gi;
-    gi.attach_triangulation (tria);
-    std::ifstream f(mesh_filename);
-    gi.read_msh (f);
+    std::vector<unsigned int> key (subcelldata.boundary_quads[i].vertices,
+                                   subcelldata.boundary_quads[i].vertices+4);
+    std::sort (key.begin(), key.end());
+    tagged_faces.insert (key);
+  }
+  std::map<std::vector<unsigned int>, std::pair<unsigned int, std::vector<unsigned int> > > face_count;
+  for (unsigned int i=0; i<cells.size(); ++i)
+    for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
+    {
+      std::vector<unsigned int> face (n_face_vertices);
+      for (unsigned int v=0; v<n_face_vertices; ++v)
+        face[to_gmsh[v]] =
+        cells[i].vertices[to_gmsh[GeometryInfo<dim>::face_to_cell_vertices (fn, v)]];
+      std::vector<unsigned int> key = face;
+      std::sort (key.begin(), key.end());
+      auto &entry = face_count[key];
+      entry.first += 1;
+      entry.second = face;
+    }
+  for (auto it=face_count.begin(); it!=face_count.end(); ++it)
+  {
+    if (it->second.first!=1 || tagged_faces.count (it->first))
+      continue;
+    if (dim==2)
+    {
+      CellData<1> face;
+      for (unsigned int v=0; v<2; ++v)
+        face.vertices[v] = it->second.second[v];
+      face.boundary_id = vacuum_boundary_id;
+      subcelldata.boundary_lines.push_back (face);
+    }
+    else
+    {
+      CellData<2> face;
+      for (unsigned int v=0; v<4; ++v)
+        face.vertices[v] = it->second.second[v];
+      face.boundary_id = vacuum_boundary_id;
+      subcelldata.boundary_quads.push_back (face);
+    }
+  }
+
+  const unsigned int n_faces = (dim==2 ?
+                                subcelldata.boundary_lines.size() :
+                                subcelldata.boundary_quads.size());
+  buffer.clear ();
+  pack<unsigned int> (dim, buffer);
+  pack<unsigned int> (vertices.size(), buffer);
+  pack<unsigned int> (cells.size(), buffer);
+  pack<unsigned int> (n_faces, buffer);
+  for (unsigned int i=0; i<vertices.size(); ++i)
+    for (unsigned int d=0; d<dim; ++d)
+      pack<double> (vertices[i][d], buffer);
+  for (unsigned int i=0; i<cells.size(); ++i)
+  {
+    for (unsigned int v=0; v<GeometryInfo<dim>::vertices_per_cell; ++v)
+      pack<unsigned int> (cells[i].vertices[v], buffer);
+    pack<unsigned int> (cells[i].material_id, buffer);
+  }
+  for (unsigned int i=0; i<n_faces; ++i)
+  {
+    const unsigned int *face_vertices = (dim==2 ?
+                                         subcelldata.boundary_lines[i].vertices :
+                                         subcelldata.boundary_quads[i].vertices);
+    for (unsigned int v=0; v<n_face_vertices; ++v)
+      pack<unsigned int> (face_vertices[v], buffer);
+    pack<unsigned int> (dim==2 ?
+                        subcelldata.boundary_lines[i].boundary_id :
+                        subcelldata.boundary_quads[i].boundary_id, buffer);
   }
 }
 
@@ -94,16 +534,17 @@ void MeshGenerator<dim>::initialize_material_id
 {
   AssertThrow (is_mesh_generated==true,
                ExcMessage("mesh read in have to have boundary ids associated"));
+  // every coarse cell gets its id, not only locally owned ones, so that ids
+  // are correct for any partition, e.g. after Triangulation::load
   for (typename Triangulation<dim>::active_cell_iterator
        cell=tria.begin_active(); cell!=tria.end(); ++cell)
-    if (cell->is_locally_owned())
-    {
-      Point<dim> center = cell->center ();
-      std::vector<unsigned int> relative_position (3);
-      get_cell_relative_position (center, relative_position);
-      unsigned int material_id = relative_position_to_id[relative_position];
-      cell->set_material_id (material_id);
-    }
+  {
+    Point<dim> center = cell->center ();
+    std::vector<unsigned int> relative_position (3);
+    get_cell_relative_position (center, relative_position);
+    unsigned int material_id = relative_position_to_id[relative_position];
+    cell->set_material_id (material_id);
+  }
 }
 
 template <int dim>
@@ -133,51 +574,49 @@ void MeshGenerator<dim>::setup_boundary_ids
   AssertThrow (axis_max_values.size()==dim,
                ExcMessage("number of entries axis max values should be dimension"));
   
+  // all coarse cells, see initialize_material_id
   for (typename Triangulation<dim>::active_cell_iterator
        cell=tria.begin_active(); cell!=tria.end(); ++cell)
   {
-    if (cell->is_locally_owned())
+    for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
     {
-      for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
+      if (cell->face(fn)->at_boundary())
       {
-        if (cell->face(fn)->at_boundary())
+        Point<dim> ct = cell->face(fn)->center();
+        // left boundary
+        if (std::fabs(ct[0])<1.0e-14)
+          cell->face(fn)->set_boundary_id (0);
+        
+        // right boundary
+        if (std::fabs(ct[0]-axis_max_values[0])<1.0e-14)
+          cell->face(fn)->set_boundary_id (1);
+        
+        // 2D and 3D boundaries
+        if (dim>1)
         {
-          Point<dim> ct = cell->face(fn)->center();
-          // left boundary
-          if (std::fabs(ct[0])<1.0e-14)
-            cell->face(fn)->set_boundary_id (0);
+          // 2D boundaries
+          // front boundary
+          if (std::fabs(ct[1])<1.0e-14)
+            cell->face(fn)->set_boundary_id (2);
           
-          // right boundary
-          if (std::fabs(ct[0]-axis_max_values[0])<1.0e-14)
-            cell->face(fn)->set_boundary_id (1);
+          // rear boundary
+          if (std::fabs(ct[1]-axis_max_values[1])<1.0e-14)
+            cell->face(fn)->set_boundary_id (3);
           
-          // 2D and 3D boundaries
-          if (dim>1)
+          // 3D boundaries
+          if (dim>2)
           {
-            // 2D boundaries
             // front boundary
-            if (std::fabs(ct[1])<1.0e-14)
-              cell->face(fn)->set_boundary_id (2);
+            if (std::fabs(ct[2])<1.0e-14)
+              cell->face(fn)->set_boundary_id (4);
             
             // rear boundary
-            if (std::fabs(ct[1]-axis_max_values[1])<1.0e-14)
-              cell->face(fn)->set_boundary_id (3);
-            
-            // 3D boundaries
-            if (dim>2)
-            {
-              // front boundary
-              if (std::fabs(ct[2])<1.0e-14)
-                cell->face(fn)->set_boundary_id (4);
-              
-              // rear boundary
-              if (std::fabs(ct[2]-axis_max_values[2])<1.0e-14)
-                cell->face(fn)->set_boundary_id (5);
-            }
+            if (std::fabs(ct[2]-axis_max_values[2])<1.0e-14)
+              cell->face(fn)->set_boundary_id (5);
           }
         }
-      }// face
-    }// locally owned cell
+      }
+    }// face
   }// cell
 }
 
@@ -211,8 +650,6 @@ void MeshGenerator<dim>::preprocess_reflective_bc (ParameterHandler &prm)
 {
   if (have_reflective_bc)
   {
-    std::map<std::string, unsigned int> bd_names_to_id
-    {{"xmin",0}, {"xmax",1}, {"ymin",2}, {"ymax",3}, {"zmin",4}, {"zmax",5}};
     std::vector<std::string> strings = Utilities::split_string_list (prm.get ("reflective boundary names"));
     AssertThrow (strings.size()>0,
                  ExcMessage("reflective boundary names have to be entered"));
@@ -221,7 +658,7 @@ void MeshGenerator<dim>::preprocess_reflective_bc (ParameterHandler &prm)
     {
       AssertThrow(bd_names_to_id.find(strings[i])!=bd_names_to_id.end(),
                   ExcMessage("Invalid reflective boundary name: use xmin, xmax, etc."));
-      tmp.insert (bd_names_to_id[strings[i]]);
+      tmp.insert (bd_names_to_id.at(strings[i]));
     }
     auto it = tmp.begin ();
     std::ostringstream os;
@@ -238,35 +675,77 @@ void MeshGenerator<dim>::preprocess_reflective_bc (ParameterHandler &prm)
   }
 }
 
+// Besides the locally owned cells, this builds flat face lists so face kernels
+// iterate arrays instead of testing every face of every cell. Faces are
+// identified by (local cell index, face number) and appear in cell order.
+// An interior face is owned by the side with the larger CellId.
 template <int dim>
 void MeshGenerator<dim>::get_relevant_cell_iterators
 (DoFHandler<dim> &dof_handler,
  std::vector<typename DoFHandler<dim>::active_cell_iterator> &local_cells,
  std::vector<typename DoFHandler<dim>::active_cell_iterator> &ref_bd_cells,
  std::vector<bool> &is_cell_at_bd,
- std::vector<bool> &is_cell_at_ref_bd)
+ std::vector<bool> &is_cell_at_ref_bd,
+ std::vector<std::pair<unsigned int, unsigned int> > &interior_faces,
+ std::vector<typename DoFHandler<dim>::cell_iterator> &interior_face_neighbors,
+ std::vector<unsigned int> &interior_face_neighbor_face_numbers,
+ std::vector<unsigned int> &interior_face_neighbor_subface_numbers,
+ std::vector<std::pair<unsigned int, unsigned int> > &vacuum_faces,
+ std::vector<std::pair<unsigned int, unsigned int> > &reflective_faces,
+ std::vector<unsigned int> &reflective_face_boundary_ids)
 {
   for (typename DoFHandler<dim>::active_cell_iterator
        cell=dof_handler.begin_active();
        cell!=dof_handler.end(); ++cell)
     if (cell->is_locally_owned())
     {
+      unsigned int ic = local_cells.size ();
       local_cells.push_back (cell);
       if (cell->at_boundary())
         is_cell_at_bd.push_back (true);
       else
         is_cell_at_bd.push_back (false);
       
-      if (have_reflective_bc)
+      bool at_ref_bd = false;
+      for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
       {
-        bool at_ref_bd = false;
-        for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
-          if (cell->at_boundary(fn))
+        if (cell->at_boundary(fn))
+        {
+          unsigned int bd_id = cell->face(fn)->boundary_id ();
+          if (have_reflective_bc && is_reflective_bc[bd_id])
           {
-            unsigned int bd_id = cell->face(fn)->boundary_id ();
-            if (!at_ref_bd && is_reflective_bc[bd_id])
-              at_ref_bd = true;
+            at_ref_bd = true;
+            reflective_faces.push_back (std::make_pair (ic, fn));
+            reflective_face_boundary_ids.push_back (bd_id);
           }
+          else
+            vacuum_faces.push_back (std::make_pair (ic, fn));
+        }
+        else if (cell->neighbor(fn)->has_children())
+          // the finer cells on the other side integrate this face
+          continue;
+        else if (cell->neighbor_is_coarser(fn))
+        {
+          // after local refinement the finer cell owns the face, which is a
+          // subface of the coarser neighbor's face
+          std::pair<unsigned int, unsigned int> neighbor_face =
+          cell->neighbor_of_coarser_neighbor (fn);
+          interior_faces.push_back (std::make_pair (ic, fn));
+          interior_face_neighbors.push_back (cell->neighbor(fn));
+          interior_face_neighbor_face_numbers.push_back (neighbor_face.first);
+          interior_face_neighbor_subface_numbers.push_back (neighbor_face.second);
+        }
+        else if (cell->neighbor(fn)->id()<cell->id())
+        {
+          interior_faces.push_back (std::make_pair (ic, fn));
+          interior_face_neighbors.push_back (cell->neighbor(fn));
+          interior_face_neighbor_face_numbers.push_back (cell->neighbor_face_no(fn));
+          interior_face_neighbor_subface_numbers.push_back (numbers::invalid_unsigned_int);
+        }
+      }
+      
+      if (have_reflective_bc)
+      {
         if (at_ref_bd)
         {
           ref_bd_cells.push_back (cell);
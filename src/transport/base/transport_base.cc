@@ -1,4 +1,5 @@
 #include <deal.II/fe/fe_values.h>
+#include <deal.II/base/memory_consumption.h>
 
 #include <boost/algorithm/string.hpp>
 #include <deal.II/dofs/dof_tools.h>
@@ -8,10 +9,14 @@
 #include <deal.II/lac/solver_bicgstab.h>
 
 #include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <numeric>
 
 #include "../../../include/transport/base/transport_base.h"
 #include "../../../include/aqdata/base/aq_base.h"
-#include "../../../include/aqdata/derived/aq_lsgc.h"
+#include "../../../include/aqdata/aq_factory.h"
 
 using namespace dealii;
 
@@ -31,25 +36,94 @@ linear_solver_name(prm.get("linear solver name")),
 preconditioner_name(prm.get("preconditioner name")),
 pcout(std::cout,
       (Utilities::MPI::this_mpi_process(mpi_communicator)
-       == 0))
+       == 0)),
+profiler(mpi_communicator, prm.get_bool ("do profiling")),
+telemetry(mpi_communicator, prm.get ("telemetry file name"))
 {
   if (linear_solver_name!="direct" && preconditioner_name=="bssor")
     ssor_omega = prm.get_double("ssor factor");
-  initialize_aq (prm);
+  pre_assembly_class_bytes = prm.get_double ("pre-assembly shape class memory in MB") * 1024.0 * 1024.0;
+  use_direct_assembly = prm.get_bool ("use direct matrix assembly");
+  have_ho_preconditioners = false;
+  is_warm_start = false;
+  checkpoint_interval = prm.get_integer ("checkpoint interval");
+  checkpoint_namebase = prm.get ("checkpoint file name base");
+  do_checkpoint_aflx = prm.get_bool ("checkpoint angular fluxes");
+  do_restart = prm.get_bool ("restart from checkpoint");
+  restart_generation = 0;
+  n_material_updates = 0;
+  full_reassembly_interval = prm.get_integer ("full reassembly every n material updates");
+  current_generation = 0;
+  n_si_iterations = 0;
+  measured_cost_scale = 0.0;
+  preconditioner_bytes = 0.0;
+  pre_assembly_bytes = 0.0;
+  fe = 0;
+  n_refinement_cycles = prm.get_integer ("adaptive refinement cycles");
+  refine_fraction = prm.get_double ("refinement fraction");
+  coarsen_fraction = prm.get_double ("coarsening fraction");
+  output_format = prm.get ("output format");
+  output_interval = prm.get_integer ("output every n generations");
+  do_output_subdomain = prm.get_bool ("output subdomain field");
+  do_background_output = prm.get_bool ("write output in background");
+  {
+    const std::string level = prm.get ("output compression");
+    if (level=="none")
+      output_compression = DataOutBase::VtkFlags::no_compression;
+    else if (level=="best speed")
+      output_compression = DataOutBase::VtkFlags::best_speed;
+    else if (level=="best compression")
+      output_compression = DataOutBase::VtkFlags::best_compression;
+    else
+      output_compression = DataOutBase::VtkFlags::default_compression;
+  }
   def_ptr = std_cxx11::shared_ptr<ProblemDefinition>
   (new ProblemDefinition(prm));
   msh_ptr = std_cxx11::shared_ptr<MeshGenerator<dim> >
   (new MeshGenerator<dim>(prm));
   mat_ptr = std_cxx11::shared_ptr<MaterialProperties>
   (new MaterialProperties(prm));
+  // after the materials: automatic angular orders look at cross sections
+  initialize_aq (prm);
   this->process_input ();
+  {
+    std::vector<std::string> strings = Utilities::split_string_list (prm.get ("output groups"));
+    for (unsigned int i=0; i<strings.size(); ++i)
+    {
+      unsigned int g = std::atoi (strings[i].c_str ()) - 1;
+      AssertThrow (g<n_group,
+                   ExcMessage("output groups are numbered 1 to number of groups"));
+      output_groups.push_back (g);
+    }
+    if (output_groups.size()==0)
+      for (unsigned int g=0; g<n_group; ++g)
+        output_groups.push_back (g);
+  }
   sflx_proc.resize (n_group);
   sflx_proc_prev_gen.resize (n_group);
+  
+  load_balancing = prm.get ("load balancing");
+  do_measure_cell_costs = (load_balancing=="measured");
+  {
+    std::vector<std::string> strings = Utilities::split_string_list (prm.get ("cost model cell weights"));
+    AssertThrow (strings.size()==3,
+                 ExcMessage("cost model cell weights needs three entries"));
+    source_cell_weight = std::atoi (strings[0].c_str ());
+    boundary_face_weight = std::atoi (strings[1].c_str ());
+    interface_weight = std::atoi (strings[2].c_str ());
+  }
+  if (load_balancing!="none")
+    triangulation.signals.cell_weight.connect
+    (std_cxx11::bind (&TransportBase<dim>::get_cell_weight,
+                      this,
+                      std_cxx11::_1,
+                      std_cxx11::_2));
 }
 
 template <int dim>
 TransportBase<dim>::~TransportBase ()
 {
+  finish_output ();
   dof_handler.clear();
 }
 
@@ -65,6 +139,7 @@ void TransportBase<dim>::process_input ()
     p_order = def_ptr->get_fe_order ();
     discretization = def_ptr->get_discretization ();
     have_reflective_bc = def_ptr->get_reflective_bool ();
+    is_explicit_reflective = def_ptr->get_explicit_reflective_bool ();
     do_nda = def_ptr->get_nda_bool ();
     is_eigen_problem = def_ptr->get_eigen_problem_bool ();
     do_print_sn_quad = def_ptr->get_print_sn_quad_bool ();
@@ -73,30 +148,27 @@ void TransportBase<dim>::process_input ()
 
     // from angular quadrature data
     n_azi = aqd_ptr->get_sn_order ();
-    n_dir = aqd_ptr->get_n_dir ();
-    n_total_ho_vars = aqd_ptr->get_n_total_ho_vars ();
-    component_index = aqd_ptr->get_component_index_map ();
-    inverse_component_index = aqd_ptr->get_inv_component_map ();
-    wi = aqd_ptr->get_angular_weights ();
-    omega_i = aqd_ptr->get_all_directions ();
+    combine_group_quadratures ();
     if (transport_model_name=="ep" &&
         discretization=="dfem")
-    {
-      tensor_norms = aqd_ptr->get_tensor_norms ();
       c_penalty = 1.0 * p_order * (p_order + 1.0);
-    }
 
   }
 
   if (have_reflective_bc)
   {
     is_reflective_bc = msh_ptr->get_reflective_bc_map ();
-    reflective_direction_index = aqd_ptr->get_reflective_direction_index_map ();
   }
 
+  relative_position_to_id = msh_ptr->get_id_map ();
+  load_material_data ();
+}
+
+template <int dim>
+void TransportBase<dim>::load_material_data ()
+{
   // material properties
   {
-    relative_position_to_id = msh_ptr->get_id_map ();
     all_sigt = mat_ptr->get_sigma_t ();
     all_inv_sigt = mat_ptr->get_inv_sigma_t ();
     all_sigs = mat_ptr->get_sigma_s ();
@@ -120,11 +192,163 @@ template <int dim>
 void TransportBase<dim>::initialize_aq (ParameterHandler &prm)
 {
   aq_name = prm.get ("angular quadrature name");
-  AssertThrow (aq_name=="lsgc",
-               ExcMessage("only LS-GC quadrature is implemented now."));
-  if (aq_name=="lsgc")
-    aqd_ptr = std_cxx11::shared_ptr<AQBase<dim> > (new AQLSGC<dim>(prm));
+  aqd_ptr = build_aq_model<dim> (prm);
   aqd_ptr->make_aq (prm);
+
+  choose_group_sn_orders (prm);
+
+  // every coarse angular multigrid level halves the orders, down to S2;
+  // levels that would not coarsen any group are dropped
+  n_mg_levels = prm.get_integer ("angular multigrid levels");
+  n_mg_sweeps = prm.get_integer ("angular multigrid sweeps");
+  mg_sn_orders.clear ();
+  std::vector<unsigned int> orders = group_sn_orders;
+  for (unsigned int l=0; l<n_mg_levels; ++l)
+  {
+    bool is_coarser = false;
+    for (unsigned int g=0; g<orders.size(); ++g)
+    {
+      const unsigned int order = std::max (2u, orders[g] / 2 - (orders[g] / 2) % 2);
+      is_coarser = is_coarser || order<orders[g];
+      orders[g] = order;
+    }
+    if (!is_coarser)
+      break;
+    mg_sn_orders.push_back (orders);
+  }
+  n_mg_levels = mg_sn_orders.size ();
+
+  group_aqs.clear ();
+  std::vector<unsigned int> all_orders = group_sn_orders;
+  for (unsigned int l=0; l<n_mg_levels; ++l)
+    all_orders.insert (all_orders.end(), mg_sn_orders[l].begin(), mg_sn_orders[l].end());
+  for (unsigned int i=0; i<all_orders.size(); ++i)
+  {
+    const unsigned int order = all_orders[i];
+    if (group_aqs.count (order))
+      continue;
+    if (order==aqd_ptr->get_sn_order ())
+      group_aqs[order] = aqd_ptr;
+    else
+    {
+      group_aqs[order] = build_aq_model<dim> (prm);
+      group_aqs[order]->set_sn_order (order);
+      group_aqs[order]->make_aq (prm);
+    }
+  }
+}
+
+// SN order per group: an explicit table, or automatic from the mean free
+// paths. A group whose longest mean free path (over all materials) is short
+// compared with the other groups' has a nearly isotropic angular flux, so
+// the order is scaled by the square root of that ratio and kept between
+// the minimum and "angular quadrature order".
+template <int dim>
+void TransportBase<dim>::choose_group_sn_orders (ParameterHandler &prm)
+{
+  const unsigned int n_groups = prm.get_integer ("number of groups");
+  const unsigned int base_order = prm.get_integer ("angular quadrature order");
+  std::vector<std::string> strings =
+  Utilities::split_string_list (prm.get ("angular quadrature orders per group"));
+  group_sn_orders.clear ();
+  if (strings.size()>0)
+  {
+    AssertThrow (strings.size()==n_groups,
+                 ExcMessage("angular quadrature orders per group needs one order per group"));
+    for (unsigned int g=0; g<n_groups; ++g)
+      group_sn_orders.push_back (std::atoi (strings[g].c_str ()));
+  }
+  else if (prm.get_bool ("automatic angular orders"))
+  {
+    unsigned int min_order = prm.get_integer ("minimum angular quadrature order");
+    min_order = std::min (base_order, min_order + min_order % 2);
+    std::vector<std::vector<double> > sigt = mat_ptr->get_sigma_t ();
+    std::vector<double> max_mfp (n_groups, 0.0);
+    for (unsigned int m=0; m<sigt.size(); ++m)
+      for (unsigned int g=0; g<n_groups; ++g)
+        max_mfp[g] = std::max (max_mfp[g],
+                               (sigt[m][g]>1.0e-13 ? 1.0 / sigt[m][g] :
+                                std::numeric_limits<double>::max ()));
+    const double longest = *std::max_element (max_mfp.begin(), max_mfp.end());
+    for (unsigned int g=0; g<n_groups; ++g)
+    {
+      unsigned int order = 2 * static_cast<unsigned int>
+      (std::ceil (0.5 * base_order * std::sqrt (max_mfp[g] / longest)));
+      group_sn_orders.push_back (std::max (min_order, std::min (base_order, order)));
+    }
+  }
+  else
+    group_sn_orders.resize (n_groups, base_order);
+}
+
+// The directions of all group sets go into one catalog, highest order
+// first, so that everything indexed by direction (streaming matrices at
+// quadrature points, reflective maps, tensor norms) stays a flat array. With
+// a single set this is just that set and its layout. Components of the
+// coarse angular multigrid levels are appended to the layout so that the
+// assembly builds their matrices like any other component's.
+template <int dim>
+void TransportBase<dim>::combine_group_quadratures ()
+{
+  omega_i.clear ();
+  wi.clear ();
+  tensor_norms.clear ();
+  reflective_direction_index.clear ();
+  std::map<unsigned int, unsigned int> first_direction_of_order;
+  for (auto it=group_aqs.rbegin(); it!=group_aqs.rend(); ++it)
+  {
+    const unsigned int first = omega_i.size ();
+    first_direction_of_order[it->first] = first;
+    std::vector<Tensor<1, dim> > omega = it->second->get_all_directions ();
+    std::vector<double> w = it->second->get_angular_weights ();
+    omega_i.insert (omega_i.end(), omega.begin(), omega.end());
+    wi.insert (wi.end(), w.begin(), w.end());
+    if (transport_model_name=="ep" &&
+        discretization=="dfem")
+    {
+      std::vector<double> norms = it->second->get_tensor_norms ();
+      tensor_norms.insert (tensor_norms.end(), norms.begin(), norms.end());
+    }
+    if (have_reflective_bc)
+    {
+      std::map<std::pair<unsigned int, unsigned int>, unsigned int> ref =
+      it->second->get_reflective_direction_index_map ();
+      for (auto r=ref.begin(); r!=ref.end(); ++r)
+        reflective_direction_index[std::make_pair (r->first.first,
+                                                   r->first.second+first)] = r->second + first;
+    }
+  }
+  n_dir = omega_i.size ();
+
+  if (group_aqs.size()==1)
+  {
+    component_layout = group_aqs.begin()->second->get_component_layout ();
+    n_total_ho_vars = group_aqs.begin()->second->get_n_total_ho_vars ();
+  }
+  else
+  {
+    std::vector<unsigned int> group_first_direction (n_group), group_n_dir (n_group);
+    for (unsigned int g=0; g<n_group; ++g)
+    {
+      group_first_direction[g] = first_direction_of_order[group_sn_orders[g]];
+      group_n_dir[g] = group_aqs[group_sn_orders[g]]->get_n_dir ();
+    }
+    component_layout = ComponentLayout (group_first_direction, group_n_dir);
+    n_total_ho_vars = component_layout.get_n_components ();
+  }
+
+  mg_first_component.assign (n_mg_levels, std::vector<unsigned int> (n_group));
+  mg_n_dir.assign (n_mg_levels, std::vector<unsigned int> (n_group));
+  for (unsigned int l=0; l<n_mg_levels; ++l)
+    for (unsigned int g=0; g<n_group; ++g)
+    {
+      const unsigned int order = mg_sn_orders[l][g];
+      mg_n_dir[l][g] = group_aqs[order]->get_n_dir ();
+      mg_first_component[l][g] =
+      component_layout.add_components (first_direction_of_order[order],
+                                       mg_n_dir[l][g], g);
+    }
+  n_ho_sys = n_total_ho_vars + component_layout.get_n_added_components ();
 }
 
 template <int dim>
@@ -133,6 +357,21 @@ void TransportBase<dim>::report_system ()
   pcout << "SN quadrature order: " << n_azi << std::endl
   << "Number of angles: " << n_dir << std::endl
   << "Number of groups: " << n_group << std::endl;
+  for (auto it=group_aqs.rbegin(); it!=group_aqs.rend(); ++it)
+    pcout << it->second->produce_accuracy_summary () << std::endl;
+  if (group_aqs.size()>1)
+  {
+    pcout << "SN order per group:";
+    for (unsigned int g=0; g<n_group; ++g)
+      pcout << " " << group_sn_orders[g];
+    pcout << std::endl;
+    radio ("HO components", n_total_ho_vars);
+  }
+  if (n_mg_levels>0)
+  {
+    radio ("Angular multigrid levels", n_mg_levels);
+    radio ("HO systems with coarse levels", n_ho_sys);
+  }
 
   radio ("Transport model", transport_model_name);
   radio ("Spatial discretization", discretization);
@@ -140,8 +379,22 @@ void TransportBase<dim>::report_system ()
   if (linear_solver_name!="direct")
     radio ("Preconditioner", preconditioner_name);
   radio ("do NDA?", do_nda);
+  radio ("Component ordering", component_layout.get_ordering ());
   
   radio ("Number of cells", triangulation.n_global_active_cells());
+  {
+    // work estimate of the cost model on top of the base weight per cell
+    double local_work = 0.0;
+    for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+      local_work += 1000.0 + get_cost_model_weight (local_cells[ic]);
+    Utilities::MPI::MinMaxAvg work = Utilities::MPI::min_max_avg (local_work, mpi_communicator);
+    Utilities::MPI::MinMaxAvg cells = Utilities::MPI::min_max_avg (static_cast<double>(local_cells.size ()),
+                                                                   mpi_communicator);
+    radio ("Load balancing", load_balancing);
+    pcout << "Owned cells per processor min/avg/max: "
+    << cells.min << "/" << cells.avg << "/" << cells.max << std::endl;
+    radio ("Estimated work imbalance (max/avg)", work.max / work.avg);
+  }
   radio ("High-order total DoF counts", n_total_ho_vars*dof_handler.n_dofs());
 
   if (is_eigen_problem)
@@ -155,12 +408,429 @@ void TransportBase<dim>::report_system ()
   radio ("is eigenvalue problem?", is_eigen_problem);
 }
 
+// Bytes per processor of the structures of the HO/LO system, as allocated.
+// The replicated scalar fluxes are counted at their full size, which they
+// reach with the first sweep.
+template <int dim>
+void TransportBase<dim>::report_memory ()
+{
+  MemoryReport report (mpi_communicator, "Memory of the HO/LO system");
+  
+  double matrix_bytes = 0.0;
+  for (unsigned int k=0; k<vec_ho_sys.size(); ++k)
+    matrix_bytes += dynamic_cast<SharedPatternMatrix*>(vec_ho_sys[k])->memory_consumption ();
+  report.add ("HO matrices", matrix_bytes);
+  if (do_nda)
+  {
+    matrix_bytes = 0.0;
+    for (unsigned int g=0; g<vec_lo_sys.size(); ++g)
+      matrix_bytes += dynamic_cast<SharedPatternMatrix*>(vec_lo_sys[g])->memory_consumption ();
+    report.add ("LO matrices", matrix_bytes);
+  }
+  
+  std::vector<std::pair<std::string, std::vector<std::vector<LA::MPI::Vector*>*> > > vectors (3);
+  vectors[0].first = "HO angular fluxes";
+  vectors[0].second.push_back (&vec_aflx);
+  vectors[1].first = "HO right-hand sides";
+  vectors[1].second.push_back (&vec_ho_rhs);
+  vectors[1].second.push_back (&vec_ho_fixed_rhs);
+  vectors[2].first = "HO scalar fluxes";
+  vectors[2].second.push_back (&vec_ho_sflx);
+  vectors[2].second.push_back (&vec_ho_sflx_old);
+  vectors[2].second.push_back (&vec_ho_sflx_prev_gen);
+  if (do_nda)
+  {
+    vectors.resize (4);
+    vectors[3].first = "LO vectors";
+    vectors[3].second.push_back (&vec_lo_rhs);
+    vectors[3].second.push_back (&vec_lo_fixed_rhs);
+    vectors[3].second.push_back (&vec_lo_sflx);
+    vectors[3].second.push_back (&vec_lo_sflx_old);
+    vectors[3].second.push_back (&vec_lo_sflx_prev_gen);
+  }
+  for (unsigned int i=0; i<vectors.size(); ++i)
+  {
+    double bytes = 0.0;
+    for (unsigned int j=0; j<vectors[i].second.size(); ++j)
+      for (unsigned int k=0; k<vectors[i].second[j]->size(); ++k)
+        bytes += (*vectors[i].second[j])[k]->memory_consumption ();
+    report.add (vectors[i].first, bytes);
+  }
+  
+  const double replicated = (n_group * (is_eigen_problem ? 2.0 : 1.0) *
+                             dof_handler.n_dofs () * sizeof (double));
+  report.add ("replicated scalar fluxes",
+              std::max (replicated,
+                        static_cast<double>(MemoryConsumption::memory_consumption (sflx_proc) +
+                                            MemoryConsumption::memory_consumption (sflx_proc_prev_gen) +
+                                            MemoryConsumption::memory_consumption (lo_sflx_proc))));
+  report.add ("preconditioners (resident growth)", preconditioner_bytes);
+  report.add ("test functions at qp", MemoryConsumption::memory_consumption (vec_test_at_qp));
+  report.add ("pre-assembly matrices (transient)", pre_assembly_bytes);
+  report.add ("cell and face cache",
+              MemoryConsumption::memory_consumption (cell_dof_indices) +
+              MemoryConsumption::memory_consumption (cell_material_ids) +
+              MemoryConsumption::memory_consumption (cell_jxw) +
+              MemoryConsumption::memory_consumption (cell_measures) +
+              MemoryConsumption::memory_consumption (face_measures) +
+              MemoryConsumption::memory_consumption (face_normals) +
+              MemoryConsumption::memory_consumption (face_boundary_ids) +
+              MemoryConsumption::memory_consumption (face_neighbor_indices) +
+              MemoryConsumption::memory_consumption (face_neighbor_material_ids) +
+              MemoryConsumption::memory_consumption (face_neighbor_measures) +
+              MemoryConsumption::memory_consumption (interior_face_neighbor_dof_indices) +
+              MemoryConsumption::memory_consumption (cell_shape_classes));
+  report.add ("direct assembly offsets",
+              MemoryConsumption::memory_consumption (cell_matrix_offsets) +
+              MemoryConsumption::memory_consumption (interface_matrix_offsets));
+  report.add ("mesh and DoF handler",
+              triangulation.memory_consumption () + dof_handler.memory_consumption ());
+  report.print (pcout.get_stream ());
+  
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats (stats);
+  Utilities::MPI::MinMaxAvg rss = Utilities::MPI::min_max_avg (stats.VmRSS / 1024.0,
+                                                               mpi_communicator);
+  pcout << "Resident memory per processor min/avg/max [MB]: "
+  << rss.min << "/" << rss.avg << "/" << rss.max << std::endl;
+}
+
+// Cells come from the coarse mesh and the uniform refinements. DoF and
+// nonzero counts are those of interior cells: exact for DFEM, the asymptotic
+// p^dim DoFs per cell for CFEM. Generated meshes have a single cell shape.
+template <int dim>
+typename TransportBase<dim>::SystemSize TransportBase<dim>::estimate_system_size ()
+{
+  msh_ptr->make_coarse_grid (triangulation);
+  
+  SystemSize size;
+  size.n_cells = (triangulation.n_global_active_cells () *
+                  std::pow (2.0, static_cast<double>(dim * global_refinements)));
+  size.dofs_per_cell = Utilities::fixed_power<dim> (p_order + 1);
+  size.n_q = Utilities::fixed_power<dim> (p_order + 1);
+  if (discretization=="dfem")
+  {
+    size.n_dofs = size.n_cells * size.dofs_per_cell;
+    size.nnz_per_row = size.dofs_per_cell * (1.0 + GeometryInfo<dim>::faces_per_cell);
+  }
+  else
+  {
+    size.n_dofs = size.n_cells * Utilities::fixed_power<dim> (p_order);
+    size.nnz_per_row = Utilities::fixed_power<dim> (2 * p_order + 1);
+  }
+  const double class_bytes = (size.n_q * (n_dir + 1.0) *
+                             size.dofs_per_cell * size.dofs_per_cell * sizeof (double));
+  size.n_shape_classes = (def_ptr->get_generated_mesh_bool () ?
+                          1 : static_cast<unsigned int>(pre_assembly_class_bytes / class_bytes));
+  return size;
+}
+
+// Rough preconditioner storage per HO system relative to the matrix: hypre
+// BoomerAMG hierarchies take about 2.5 times the operator with
+// interpolation, ParaSails and block Jacobi ILU(0) about one copy of it, the
+// point preconditioners a vector or two. MUMPS fill is taken as 10 (2D) and
+// 30 (3D) times the matrix and varies a lot with the ordering.
+template <int dim>
+double TransportBase<dim>::get_preconditioner_bytes (double local_rows,
+                                                     double local_nnz)
+{
+  const double matrix = local_nnz * (sizeof (PetscScalar) + sizeof (PetscInt));
+  if (linear_solver_name=="direct")
+    return (dim==2 ? 10.0 : 30.0) * matrix;
+  if (preconditioner_name=="amg")
+    return 2.5 * matrix;
+  if (preconditioner_name=="parasails")
+    return matrix;
+  if (preconditioner_name=="bjacobi")
+    return matrix + local_rows * sizeof (PetscInt);
+  if (preconditioner_name=="bssor")
+    return 2.0 * local_rows * sizeof (PetscScalar);
+  return local_rows * sizeof (PetscScalar);
+}
+
+// Same rows as report_memory () for an even partition over n_ranks
+// processors; ghost entries and layers are not included.
+template <int dim>
+void TransportBase<dim>::add_predicted_memory (MemoryReport &report,
+                                               const SystemSize &size,
+                                               unsigned int n_ranks)
+{
+  const double cells = size.n_cells / n_ranks;
+  const double rows = size.n_dofs / n_ranks;
+  const double nnz = rows * size.nnz_per_row;
+  const double dpc = size.dofs_per_cell;
+  const double faces = GeometryInfo<dim>::faces_per_cell;
+  const double value = sizeof (PetscScalar);
+  const double index = sizeof (PetscInt);
+  
+  // the first HO matrix owns column indices and the row offsets of the
+  // diagonal and off-diagonal blocks, all other matrices share them
+  report.add ("HO matrices", nnz * index + 2.0 * rows * index + n_ho_sys * nnz * value);
+  if (do_nda)
+    report.add ("LO matrices", n_group * nnz * value);
+  report.add ("HO angular fluxes", n_ho_sys * rows * value);
+  report.add ("HO right-hand sides", (n_ho_sys + n_total_ho_vars) * rows * value);
+  report.add ("HO scalar fluxes", 3.0 * n_group * rows * value);
+  if (do_nda)
+    report.add ("LO vectors", 5.0 * n_group * rows * value);
+  report.add ("replicated scalar fluxes",
+              n_group * (is_eigen_problem ? 2.0 : 1.0) * size.n_dofs * sizeof (double));
+  report.add ("preconditioners", n_ho_sys * get_preconditioner_bytes (rows, nnz));
+  report.add ("test functions at qp", cells * size.n_q * dpc * sizeof (double));
+  report.add ("pre-assembly matrices (transient)",
+              (std::min (static_cast<double>(size.n_shape_classes), cells) + 1.0) *
+              size.n_q * (n_dir + 1.0) * dpc * dpc * sizeof (double));
+  {
+    // per cell: DoF indices, JxW, id/class/measure, and per face measure,
+    // normal, three indices and neighbor measure; DFEM adds the neighbor
+    // DoF indices of every interior face
+    double per_cell = (dpc * sizeof (types::global_dof_index) +
+                       size.n_q * sizeof (double) + 16.0 +
+                       faces * (16.0 + dim * sizeof (double) + 12.0));
+    if (discretization=="dfem")
+      per_cell += 0.5 * faces * dpc * sizeof (types::global_dof_index);
+    report.add ("cell and face cache", cells * per_cell);
+  }
+  if (use_direct_assembly)
+    report.add ("direct assembly offsets",
+                cells * dpc * dpc * sizeof (PetscInt) *
+                (discretization=="dfem" ? 1.0 + 2.0 * faces : 1.0));
+  else
+    report.add ("direct assembly offsets", 0.0);
+  // deal.II cell, face and vertex data with the coarser levels, roughly,
+  // plus two copies of the cell DoF indices in the DoF handler
+  report.add ("mesh and DoF handler",
+              cells * ((dim==2 ? 300.0 : 700.0) + 2.0 * dpc * sizeof (types::global_dof_index)));
+}
+
+template <int dim>
+void TransportBase<dim>::predict_memory ()
+{
+  radio ("dry run: predicting memory from the input");
+  const SystemSize size = estimate_system_size ();
+  const unsigned int n_ranks = Utilities::MPI::n_mpi_processes (mpi_communicator);
+  pcout << "Predicted number of cells: " << size.n_cells << std::endl
+  << "Predicted DoFs per component: " << size.n_dofs << std::endl
+  << "Predicted HO systems: " << n_ho_sys << std::endl
+  << "Predicted nonzeros per HO matrix: " << size.n_dofs * size.nnz_per_row << std::endl;
+  
+  MemoryReport report (mpi_communicator,
+                       "Predicted memory of the HO/LO system on " +
+                       Utilities::int_to_string (n_ranks) + " processors");
+  add_predicted_memory (report, size, n_ranks);
+  report.print (pcout.get_stream ());
+}
+
+// Work model of the kernels timed by xtrans-bench, on an even partition of a
+// cube-like mesh. Assembly counts the pre-assembly of the shape classes and
+// the cell, boundary and interface forms of every HO system. A source
+// iteration is the scattering source and moments at stream speed, the
+// gather of the replicated scalar fluxes (also at stream speed, a lower
+// bound with a network in between) and one solve per HO system: the
+// matrix, the preconditioner and the Krylov vectors streamed once per
+// iteration plus two reductions whose latency grows with log2 of the
+// processors.
+template <int dim>
+void TransportBase<dim>::estimate_job_cost (const SystemSize &size,
+                                            const MachineProfile &profile,
+                                            unsigned int n_ranks,
+                                            unsigned int linear_iterations,
+                                            double &assembly_flops,
+                                            double &assembly_seconds,
+                                            double &iteration_seconds)
+{
+  const double d = size.dofs_per_cell;
+  const double n_q = size.n_q;
+  const double n_qf = Utilities::fixed_power<dim-1> (p_order + 1);
+  const double n_comp = n_ho_sys;
+  const double cells = size.n_cells;
+  const double rows = size.n_dofs / n_ranks;
+  const double nnz = rows * size.nnz_per_row;
+  
+  const double pre_assembly = (std::min (static_cast<double>(size.n_shape_classes), cells / n_ranks) *
+                               n_q * (n_dir * d * d * (4.0 * dim - 1.0) + d * d));
+  const double boundary_faces = (2.0 * dim * std::pow (cells, (dim - 1.0) / dim));
+  double forms = (cells * n_comp * n_q * d * d * 5.0 +
+                  boundary_faces * n_comp * n_qf * d * d * 3.0);
+  if (discretization=="dfem")
+    forms += dim * cells * n_comp * n_qf * d * d * 32.0;
+  assembly_flops = n_ranks * pre_assembly + forms;
+  assembly_seconds = (pre_assembly + forms / n_ranks) / (1.0e9 * profile.assembly_gflops);
+  
+  const double stream_bytes = (8.0 * (n_group * cells * (n_group * d + n_q * d) +
+                                      2.0 * n_comp * size.n_dofs) +
+                               8.0 * size.n_dofs * (2.0 * n_comp + 3.0 * n_group)) / n_ranks;
+  const double gather_bytes = (n_ranks>1 ? n_group * size.n_dofs * sizeof (double) : 0.0);
+  
+  const double latency = (profile.allreduce_latency *
+                          std::log2 (std::max (2.0, static_cast<double>(n_ranks))) /
+                          std::log2 (std::max (2.0, static_cast<double>(profile.calibration_processes))));
+  double solve_seconds;
+  if (linear_solver_name=="direct")
+    solve_seconds = get_preconditioner_bytes (rows, nnz) / (1.0e9 * profile.matrix_vector_gbs);
+  else
+    solve_seconds = linear_iterations *
+    ((12.0 * nnz + 16.0 * rows + 48.0 * rows + get_preconditioner_bytes (rows, nnz)) /
+     (1.0e9 * profile.matrix_vector_gbs) + (n_ranks>1 ? 2.0 * latency : 0.0));
+  
+  iteration_seconds = ((stream_bytes + gather_bytes) / (1.0e9 * profile.stream_gbs) +
+                       n_comp * solve_seconds);
+}
+
+// Processor counts are powers of two up to the node limit. Per count the
+// ranks per node are limited by the cores and by 90% of the node memory;
+// cores left over by memory-limited ranks go to threads of PETSc and hypre.
+// The recommendation is the largest count that fits and keeps the
+// efficiency of a source iteration, relative to one processor, at or above
+// 70%, or the smallest count that fits if none does.
+template <int dim>
+void TransportBase<dim>::plan_job (ParameterHandler &prm)
+{
+  radio ("plan only: estimating the job from the coarse mesh and quadrature");
+  MachineProfile profile;
+  profile.read (prm.get ("machine profile file name"));
+  const unsigned int linear_iterations = prm.get_integer ("planned linear iterations per HO solve");
+  const unsigned int max_nodes = prm.get_integer ("maximum planned nodes");
+  const double min_efficiency = 0.7;
+  
+  const SystemSize size = estimate_system_size ();
+  pcout << "Predicted number of cells: " << size.n_cells << std::endl
+  << "Predicted DoFs per component: " << size.n_dofs << std::endl
+  << "HO systems: " << n_ho_sys << " (" << n_total_ho_vars << " fine components)" << std::endl
+  << "Predicted HO unknowns: " << n_ho_sys * size.n_dofs << std::endl
+  << "Predicted nonzeros per HO matrix: " << size.n_dofs * size.nnz_per_row << std::endl;
+  if (!profile.is_calibrated ())
+    pcout << "No machine profile given: rates of an uncalibrated default node" << std::endl;
+  pcout << "Node: " << profile.cores_per_node << " cores, "
+  << profile.memory_per_node_mb / 1024.0 << " GB" << std::endl;
+  
+  double flops, serial_assembly, serial_iteration;
+  estimate_job_cost (size, profile, 1, linear_iterations,
+                     flops, serial_assembly, serial_iteration);
+  pcout << "Assembly work: " << flops * 1.0e-9 << " GFLOP, "
+  << serial_assembly << " s on one processor" << std::endl;
+  
+  std::ostringstream table;
+  table << std::setw(8) << "procs"
+  << std::setw(7) << "nodes"
+  << std::setw(11) << "procs/node"
+  << std::setw(13) << "threads/proc"
+  << std::setw(14) << "MB/proc"
+  << std::setw(14) << "assembly [s]"
+  << std::setw(14) << "SI [s]"
+  << std::setw(12) << "efficiency" << std::endl;
+  
+  unsigned int best_ranks = 0, best_nodes = 0, best_per_node = 0;
+  double best_seconds = 0.0;
+  for (unsigned int n_ranks=1; n_ranks<=max_nodes*profile.cores_per_node; n_ranks*=2)
+  {
+    MemoryReport report (mpi_communicator, "");
+    add_predicted_memory (report, size, n_ranks);
+    const double mb = report.get_local_bytes () / (1024.0 * 1024.0);
+    const unsigned int per_node = std::min (std::min (profile.cores_per_node, n_ranks),
+                                            static_cast<unsigned int>(0.9 * profile.memory_per_node_mb / mb));
+    double assembly, iteration;
+    estimate_job_cost (size, profile, n_ranks, linear_iterations,
+                       flops, assembly, iteration);
+    const double efficiency = serial_iteration / (n_ranks * iteration);
+    
+    table << std::setw(8) << n_ranks;
+    if (per_node==0)
+      table << std::setw(7) << "-" << std::setw(11) << "-" << std::setw(13) << "-";
+    else
+      table << std::setw(7) << (n_ranks + per_node - 1) / per_node
+      << std::setw(11) << per_node
+      << std::setw(13) << std::max (1u, profile.cores_per_node / per_node);
+    table << std::fixed << std::setprecision (1) << std::setw(14) << mb
+    << std::setprecision (3) << std::setw(14) << assembly
+    << std::setw(14) << iteration
+    << std::setprecision (2) << std::setw(12) << efficiency << std::endl;
+    table.unsetf (std::ios_base::floatfield);
+    
+    if (per_node>0 &&
+        (best_ranks==0 || efficiency>=min_efficiency))
+    {
+      best_ranks = n_ranks;
+      best_per_node = per_node;
+      best_nodes = (n_ranks + per_node - 1) / per_node;
+      best_seconds = iteration;
+    }
+  }
+  
+  pcout << table.str ();
+  if (best_ranks==0)
+    pcout << "The problem does not fit on " << max_nodes << " nodes" << std::endl;
+  else
+    pcout << "Recommended: " << best_ranks << " processors on " << best_nodes
+    << " nodes, " << best_per_node << " processors per node with "
+    << std::max (1u, profile.cores_per_node / best_per_node)
+    << " threads each (OMP_NUM_THREADS), about " << best_seconds
+    << " s per source iteration" << std::endl;
+}
+
 template <int dim>
 void TransportBase<dim>::setup_system ()
 {
   radio ("setup system");
   initialize_dealii_objects ();
+  initialize_cell_face_cache ();
+  initialize_cell_shape_classes ();
   initialize_system_matrices_vectors ();
+  initialize_direct_assembly ();
+}
+
+// Computes where every local cell and interface matrix entry lives in the
+// value arrays of the shared structure. The structure copy is dropped once
+// all offsets are known. Without direct assembly the offset lists stay empty.
+template <int dim>
+void TransportBase<dim>::initialize_direct_assembly ()
+{
+  cell_matrix_offsets.resize (local_cells.size());
+  interface_matrix_offsets.resize (4 * interior_faces.size());
+  if (!use_direct_assembly)
+    return;
+  
+  direct_assembler.initialize (*vec_ho_sys[0]);
+  
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+    direct_assembler.compute_offsets (cell_dof_indices[ic],
+                                      cell_dof_indices[ic],
+                                      cell_matrix_offsets[ic]);
+  
+  for (unsigned int i_face=0; i_face<interior_faces.size(); ++i_face)
+  {
+    const std::vector<types::global_dof_index> &up_dofs =
+    cell_dof_indices[interior_faces[i_face].first];
+    const std::vector<types::global_dof_index> &un_dofs =
+    interior_face_neighbor_dof_indices[i_face];
+    direct_assembler.compute_offsets (up_dofs, up_dofs,
+                                      interface_matrix_offsets[4*i_face]);
+    direct_assembler.compute_offsets (up_dofs, un_dofs,
+                                      interface_matrix_offsets[4*i_face+1]);
+    direct_assembler.compute_offsets (un_dofs, up_dofs,
+                                      interface_matrix_offsets[4*i_face+2]);
+    direct_assembler.compute_offsets (un_dofs, un_dofs,
+                                      interface_matrix_offsets[4*i_face+3]);
+  }
+  
+  direct_assembler.release_pattern ();
+}
+
+template <int dim>
+void TransportBase<dim>::add_to_ho_matrix
+(unsigned int k,
+ const std::vector<PetscInt> &offsets,
+ const std::vector<types::global_dof_index> &rows,
+ const std::vector<types::global_dof_index> &cols,
+ const FullMatrix<double> &local_matrix)
+{
+  // hanging nodes of adapted CFEM meshes are condensed on the fly
+  if (constraints.n_constraints ()>0)
+    constraints.distribute_local_to_global (local_matrix, rows, cols, *vec_ho_sys[k]);
+  else if (use_direct_assembly)
+    direct_assembler.add (*vec_ho_sys[k], offsets, rows, cols, local_matrix);
+  else
+    vec_ho_sys[k]->add (rows, cols, local_matrix);
 }
 
 template <int dim>
@@ -204,7 +874,7 @@ void TransportBase<dim>::initialize_system_matrices_vectors ()
   {
     if (do_nda)
     {
-      vec_lo_sys.push_back (new LA::MPI::SparseMatrix);
+      vec_lo_sys.push_back (new SharedPatternMatrix);
       vec_lo_rhs.push_back (new LA::MPI::Vector);
       vec_lo_sflx.push_back (new LA::MPI::Vector);
       vec_lo_sflx_old.push_back (new LA::MPI::Vector);
@@ -215,23 +885,39 @@ void TransportBase<dim>::initialize_system_matrices_vectors ()
     vec_ho_sflx_prev_gen.push_back (new LA::MPI::Vector);
     vec_ho_sflx_old.push_back (new LA::MPI::Vector);
 
-    for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
+    for (unsigned int i_dir=component_layout.first_direction (g);
+         i_dir<component_layout.end_direction (g); ++i_dir)
     {
-      vec_ho_sys.push_back (new LA::MPI::SparseMatrix);
+      vec_ho_sys.push_back (new SharedPatternMatrix);
       vec_aflx.push_back (new LA::MPI::Vector);
       vec_ho_rhs.push_back (new LA::MPI::Vector);
       vec_ho_fixed_rhs.push_back (new LA::MPI::Vector);
     }
   }
 
+  // coarse angular multigrid components need no fixed source
+  for (unsigned int k=n_total_ho_vars; k<n_ho_sys; ++k)
+  {
+    vec_ho_sys.push_back (new SharedPatternMatrix);
+    vec_aflx.push_back (new LA::MPI::Vector);
+    vec_ho_rhs.push_back (new LA::MPI::Vector);
+  }
+
+  // The first HO matrix owns the sparsity structure built from dsp. All other
+  // HO and LO matrices share its row offsets and column indices and store
+  // values only.
+  vec_ho_sys[0]->reinit (local_dofs,
+                         local_dofs,
+                         dsp,
+                         mpi_communicator);
+  for (unsigned int k=1; k<n_ho_sys; ++k)
+    dynamic_cast<SharedPatternMatrix*>(vec_ho_sys[k])->reinit_with_shared_pattern (*vec_ho_sys[0]);
+
   for (unsigned int g=0; g<n_group; ++g)
   {
     if (do_nda)
     {
-      vec_lo_sys[g]->reinit (local_dofs,
-                             local_dofs,
-                             dsp,
-                             mpi_communicator);
+      dynamic_cast<SharedPatternMatrix*>(vec_lo_sys[g])->reinit_with_shared_pattern (*vec_ho_sys[0]);
       vec_lo_rhs[g]->reinit (local_dofs,
                              mpi_communicator);
       vec_lo_fixed_rhs[g]->reinit (local_dofs,
@@ -247,12 +933,9 @@ void TransportBase<dim>::initialize_system_matrices_vectors ()
     vec_ho_sflx_old[g]->reinit (local_dofs,
                                 mpi_communicator);
 
-    for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
+    for (unsigned int i_dir=component_layout.first_direction (g);
+         i_dir<component_layout.end_direction (g); ++i_dir)
     {
-      vec_ho_sys[get_component_index(i_dir, g)]->reinit(local_dofs,
-                                                        local_dofs,
-                                                        dsp,
-                                                        mpi_communicator);
       vec_aflx[get_component_index(i_dir, g)]->reinit(local_dofs,
                                                       mpi_communicator);
       vec_ho_rhs[get_component_index(i_dir, g)]->reinit (local_dofs,
@@ -261,11 +944,17 @@ void TransportBase<dim>::initialize_system_matrices_vectors ()
                                                                mpi_communicator);
     }
   }
+  for (unsigned int k=n_total_ho_vars; k<n_ho_sys; ++k)
+  {
+    vec_aflx[k]->reinit (local_dofs, mpi_communicator);
+    vec_ho_rhs[k]->reinit (local_dofs, mpi_communicator);
+  }
 }
 
 template <int dim>
 void TransportBase<dim>::assemble_ho_system ()
 {
+  Profiler::Scope scope (profiler, "assemble_ho_system");
   radio ("Assemble volumetric bilinear forms");
   assemble_ho_volume_boundary ();
 
@@ -276,15 +965,29 @@ void TransportBase<dim>::assemble_ho_system ()
     radio ("Assemble cell interface bilinear forms for DFEM");
     assemble_ho_interface ();
   }
+  
+  if (do_measure_cell_costs)
+  {
+    double local_cost = std::accumulate (measured_cell_costs.begin (),
+                                         measured_cell_costs.end (), 0.0);
+    double global_cost = Utilities::MPI::sum (local_cost, mpi_communicator);
+    measured_cost_scale = (global_cost>0.0 ?
+                           1000.0 * triangulation.n_global_active_cells () / global_cost :
+                           0.0);
+  }
 }
 
 template <int dim>
 void TransportBase<dim>::initialize_dealii_objects ()
 {
-  if (discretization=="dfem")
-    fe = (new FE_DGQ<dim> (p_order));
-  else
-    fe = (new FE_Q<dim> (p_order));
+  // the element survives mesh adaptation, only DoFs are redistributed
+  if (fe==0)
+  {
+    if (discretization=="dfem")
+      fe = (new FE_DGQ<dim> (p_order));
+    else
+      fe = (new FE_Q<dim> (p_order));
+  }
 
   dof_handler.distribute_dofs (*fe);
 
@@ -319,6 +1022,12 @@ void TransportBase<dim>::initialize_dealii_objects ()
                           update_quadrature_points | update_normal_vectors |
                           update_JxW_values));
 
+  fvf_nei_sub = std_cxx11::shared_ptr<FESubfaceValues<dim> >
+  (new FESubfaceValues<dim> (*fe, *qf_rule,
+                             update_values | update_gradients |
+                             update_quadrature_points | update_normal_vectors |
+                             update_JxW_values));
+
   dofs_per_cell = fe->dofs_per_cell;
   n_q = q_rule->size();
   n_qf = qf_rule->size();
@@ -327,72 +1036,271 @@ void TransportBase<dim>::initialize_dealii_objects ()
   neigh_dof_indices.resize (dofs_per_cell);
 }
 
+template <int dim>
+void TransportBase<dim>::initialize_cell_face_cache ()
+{
+  const unsigned int n_cells = local_cells.size ();
+  const unsigned int n_faces = GeometryInfo<dim>::faces_per_cell;
+
+  // Shape values of Lagrange elements at quadrature points do not depend on
+  // the cell, so one reference table serves all cells
+  ref_shape_values.reinit (n_q, dofs_per_cell);
+  for (unsigned int qi=0; qi<n_q; ++qi)
+    for (unsigned int i=0; i<dofs_per_cell; ++i)
+      ref_shape_values(qi,i) = fe->shape_value (i, q_rule->point(qi));
+
+  std::map<CellId, unsigned int> local_cell_index;
+  for (unsigned int ic=0; ic<n_cells; ++ic)
+    local_cell_index[local_cells[ic]->id()] = ic;
+
+  cell_dof_indices.resize (n_cells, std::vector<types::global_dof_index> (dofs_per_cell));
+  cell_material_ids.resize (n_cells);
+  cell_jxw.resize (n_cells, std::vector<double> (n_q));
+  cell_measures.resize (n_cells);
+  face_measures.resize (n_cells*n_faces, 0.0);
+  face_normals.resize (n_cells*n_faces);
+  face_boundary_ids.resize (n_cells*n_faces, numbers::invalid_unsigned_int);
+  face_neighbor_indices.resize (n_cells*n_faces, numbers::invalid_unsigned_int);
+  face_neighbor_material_ids.resize (n_cells*n_faces, numbers::invalid_unsigned_int);
+  face_neighbor_measures.resize (n_cells*n_faces, 0.0);
+
+  for (unsigned int ic=0; ic<n_cells; ++ic)
+  {
+    typename DoFHandler<dim>::active_cell_iterator cell = local_cells[ic];
+    // lets the cell weight callback find measured costs by local index
+    cell->set_user_index (ic);
+    cell->get_dof_indices (cell_dof_indices[ic]);
+    cell_material_ids[ic] = cell->material_id ();
+    cell_measures[ic] = cell->measure ();
+    fv->reinit (cell);
+    for (unsigned int qi=0; qi<n_q; ++qi)
+      cell_jxw[ic][qi] = fv->JxW (qi);
+
+    for (unsigned int fn=0; fn<n_faces; ++fn)
+    {
+      unsigned int f = ic * n_faces + fn;
+      fvf->reinit (cell, fn);
+      face_measures[f] = cell->face(fn)->measure ();
+      face_normals[f] = fvf->normal_vector (0);
+      if (cell->at_boundary(fn))
+        face_boundary_ids[f] = cell->face(fn)->boundary_id ();
+      else
+      {
+        typename DoFHandler<dim>::cell_iterator neigh = cell->neighbor(fn);
+        face_neighbor_material_ids[f] = neigh->material_id ();
+        face_neighbor_measures[f] = neigh->measure ();
+        // neighbors owned by other processors keep an invalid local index
+        std::map<CellId, unsigned int>::iterator it = local_cell_index.find (neigh->id());
+        if (it!=local_cell_index.end())
+          face_neighbor_indices[f] = it->second;
+      }
+    }
+  }
+
+  interior_face_neighbor_dof_indices.resize
+  (interior_faces.size (), std::vector<types::global_dof_index> (dofs_per_cell));
+  for (unsigned int i_face=0; i_face<interior_faces.size(); ++i_face)
+    interior_face_neighbors[i_face]->get_dof_indices
+    (interior_face_neighbor_dof_indices[i_face]);
+}
+
+template <int dim>
+void TransportBase<dim>::initialize_cell_shape_classes ()
+{
+  // Cells that are identical up to translation have identical FEValues data
+  // and thus share pre-assembled matrices. A class is keyed by the quantized
+  // vertex offsets relative to the first vertex, which identifies affine and
+  // non-affine cells alike. Only shapes shared by two or more cells pay off:
+  // they become classes from the most populated down until the memory
+  // budget is used, and all other cells stay unclassified and are
+  // integrated through the general per-cell path.
+  cell_shape_classes.assign (local_cells.size (), numbers::invalid_unsigned_int);
+  shape_class_representatives.clear ();
+
+  double min_diameter = std::numeric_limits<double>::max ();
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+    min_diameter = std::min (min_diameter, local_cells[ic]->diameter ());
+  const double tol = 1.0e-10 * min_diameter;
+
+  std::map<std::vector<long long>, std::vector<unsigned int> > cells_of_key;
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+  {
+    typename DoFHandler<dim>::active_cell_iterator cell = local_cells[ic];
+    const Point<dim> origin = cell->vertex (0);
+    std::vector<long long> key;
+    for (unsigned int v=1; v<GeometryInfo<dim>::vertices_per_cell; ++v)
+      for (unsigned int d=0; d<dim; ++d)
+        key.push_back (std::llround ((cell->vertex(v)[d] - origin[d]) / tol));
+    cells_of_key[key].push_back (ic);
+  }
+
+  // shared shapes by decreasing population, ties by first cell
+  std::vector<std::pair<unsigned int, unsigned int> > shared_shapes;
+  std::vector<const std::vector<unsigned int>*> shape_cells;
+  for (std::map<std::vector<long long>, std::vector<unsigned int> >::iterator
+       it=cells_of_key.begin(); it!=cells_of_key.end(); ++it)
+    if (it->second.size()>=2)
+    {
+      shared_shapes.push_back (std::make_pair (it->second[0], shape_cells.size ()));
+      shape_cells.push_back (&it->second);
+    }
+  std::sort (shared_shapes.begin (), shared_shapes.end (),
+             [&shape_cells] (const std::pair<unsigned int, unsigned int> &a,
+                             const std::pair<unsigned int, unsigned int> &b)
+             {
+               const std::size_t na = shape_cells[a.second]->size ();
+               const std::size_t nb = shape_cells[b.second]->size ();
+               return (na!=nb ? na>nb : a.first<b.first);
+             });
+
+  const double class_bytes = (n_q * (n_dir + 1.0) *
+                              dofs_per_cell * dofs_per_cell * sizeof (double));
+  const std::size_t max_classes = static_cast<std::size_t>(pre_assembly_class_bytes / class_bytes);
+  for (unsigned int i=0; i<shared_shapes.size() && i<max_classes; ++i)
+  {
+    const std::vector<unsigned int> &cells = *shape_cells[shared_shapes[i].second];
+    for (unsigned int j=0; j<cells.size(); ++j)
+      cell_shape_classes[cells[j]] = i;
+    shape_class_representatives.push_back (cells[0]);
+  }
+
+  unsigned int n_unclassified = std::count (cell_shape_classes.begin (),
+                                            cell_shape_classes.end (),
+                                            numbers::invalid_unsigned_int);
+  radio ("Max pre-assembly shape classes per processor",
+         Utilities::MPI::max (static_cast<unsigned int>(shape_class_representatives.size ()),
+                              mpi_communicator));
+  radio ("Cells integrated without pre-assembly",
+         Utilities::MPI::sum (n_unclassified, mpi_communicator));
+}
+
+template <int dim>
+void TransportBase<dim>::integrate_boundary_faces_of_cell
+(unsigned int ic,
+ FullMatrix<double> &cell_matrix,
+ unsigned int i_dir,
+ unsigned int g)
+{
+  // boundary face lists are sorted by local cell index
+  std::pair<unsigned int, unsigned int> first_face (ic, 0);
+  for (std::vector<std::pair<unsigned int, unsigned int> >::iterator
+       it=std::lower_bound (vacuum_faces.begin (), vacuum_faces.end (), first_face);
+       it!=vacuum_faces.end () && it->first==ic; ++it)
+  {
+    unsigned int fn = it->second;
+    fvf->reinit (local_cells[ic], fn);
+    integrate_boundary_bilinear_form (fvf, ic, fn, cell_matrix, i_dir, g);
+  }
+  for (std::vector<std::pair<unsigned int, unsigned int> >::iterator
+       it=std::lower_bound (reflective_faces.begin (), reflective_faces.end (), first_face);
+       it!=reflective_faces.end () && it->first==ic; ++it)
+  {
+    unsigned int fn = it->second;
+    fvf->reinit (local_cells[ic], fn);
+    integrate_boundary_bilinear_form (fvf, ic, fn, cell_matrix, i_dir, g);
+  }
+}
+
 template <int dim>
 void TransportBase<dim>::assemble_ho_volume_boundary ()
 {
-  // volumetric pre-assembly matrices
-  std::vector<std::vector<FullMatrix<double> > >
-  streaming_at_qp (n_q, std::vector<FullMatrix<double> > (n_dir, FullMatrix<double> (dofs_per_cell, dofs_per_cell)));
+  Profiler::Scope scope (profiler, "assemble_ho_volume_boundary");
+  if (do_measure_cell_costs)
+    measured_cell_costs.assign (local_cells.size (), 0.0);
+  
+  // volumetric pre-assembly matrices, one set per cell shape class
+  const unsigned int n_classes = shape_class_representatives.size ();
+  std::vector<std::vector<std::vector<FullMatrix<double> > > >
+  streaming_at_qp (n_classes,
+                   std::vector<std::vector<FullMatrix<double> > >
+                   (n_q, std::vector<FullMatrix<double> > (n_dir, FullMatrix<double> (dofs_per_cell, dofs_per_cell))));
 
-  std::vector<FullMatrix<double> >
-  collision_at_qp (n_q, FullMatrix<double>(dofs_per_cell, dofs_per_cell));
+  std::vector<std::vector<FullMatrix<double> > >
+  collision_at_qp (n_classes,
+                   std::vector<FullMatrix<double> > (n_q, FullMatrix<double>(dofs_per_cell, dofs_per_cell)));
+  // together with the single cell set of the general path below
+  pre_assembly_bytes = ((n_classes + 1.0) * n_q * (n_dir + 1.0) *
+                        dofs_per_cell * dofs_per_cell * sizeof (double));
   
-  for (unsigned int i=0; i<local_cells.size(); ++i)
+  vec_test_at_qp.clear ();
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+  {
     vec_test_at_qp.push_back (FullMatrix<double> (n_q, dofs_per_cell));
+    for (unsigned int qi=0; qi<n_q; ++qi)
+      for (unsigned int i=0; i<dofs_per_cell; ++i)
+        vec_test_at_qp[ic](qi, i) = ref_shape_values(qi,i) * cell_jxw[ic][qi];
+  }
   
   // this sector is for pre-assembling streaming and collision matrices at quadrature
-  // points
+  // points on one representative cell per shape class. With measured costs
+  // the pre-assembly time of a class is shared by the cells of the class,
+  // as a cell on the general path pays for its own pre-assembly.
+  std::vector<double> class_costs (n_classes, 0.0);
+  for (unsigned int c=0; c<n_classes; ++c)
   {
-    typename DoFHandler<dim>::active_cell_iterator cell = local_cells[0];
+    const double t0 = (do_measure_cell_costs ? MPI_Wtime () : 0.0);
+    typename DoFHandler<dim>::active_cell_iterator cell = local_cells[shape_class_representatives[c]];
     fv->reinit (cell);
-    pre_assemble_cell_matrices (fv, cell, streaming_at_qp, collision_at_qp);
+    pre_assemble_cell_matrices (fv, cell, streaming_at_qp[c], collision_at_qp[c]);
+    if (do_measure_cell_costs)
+      class_costs[c] = MPI_Wtime () - t0;
   }
-
-  for (unsigned int k=0; k<n_total_ho_vars; ++k)
+  if (do_measure_cell_costs)
   {
-    unsigned int g = get_component_group (k);
-    unsigned int i_dir = get_component_direction (k);
-    radio ("Assembling Component",k,"direction",i_dir,"group",g);
-    FullMatrix<double> local_mat (dofs_per_cell, dofs_per_cell);
-
+    std::vector<unsigned int> n_class_cells (n_classes, 0);
     for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+      if (cell_shape_classes[ic]!=numbers::invalid_unsigned_int)
+        ++n_class_cells[cell_shape_classes[ic]];
+    for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+      if (cell_shape_classes[ic]!=numbers::invalid_unsigned_int)
+        measured_cell_costs[ic] = (class_costs[cell_shape_classes[ic]] /
+                                   n_class_cells[cell_shape_classes[ic]]);
+  }
+
+  radio ("Assembling Components", n_ho_sys);
+  FullMatrix<double> local_mat (dofs_per_cell, dofs_per_cell);
+  // cells without a shape class are pre-assembled one at a time; every cell
+  // contributes to all components before moving on, and is timed once
+  std::vector<std::vector<FullMatrix<double> > >
+  cell_streaming_at_qp (n_q, std::vector<FullMatrix<double> > (n_dir, FullMatrix<double> (dofs_per_cell, dofs_per_cell)));
+  std::vector<FullMatrix<double> >
+  cell_collision_at_qp (n_q, FullMatrix<double>(dofs_per_cell, dofs_per_cell));
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+  {
+    const double t0 = (do_measure_cell_costs ? MPI_Wtime () : 0.0);
+    const unsigned int c = cell_shape_classes[ic];
+    if (c==numbers::invalid_unsigned_int)
     {
       typename DoFHandler<dim>::active_cell_iterator cell = local_cells[ic];
       fv->reinit (cell);
-      cell->get_dof_indices (local_dof_indices);
+      pre_assemble_cell_matrices (fv, cell, cell_streaming_at_qp, cell_collision_at_qp);
+    }
+    std::vector<std::vector<FullMatrix<double> > > &cell_streaming =
+    (c==numbers::invalid_unsigned_int ? cell_streaming_at_qp : streaming_at_qp[c]);
+    std::vector<FullMatrix<double> > &cell_collision =
+    (c==numbers::invalid_unsigned_int ? cell_collision_at_qp : collision_at_qp[c]);
+    for (unsigned int k=0; k<n_ho_sys; ++k)
+    {
+      unsigned int g = get_component_group (k);
+      unsigned int i_dir = get_component_direction (k);
       local_mat = 0;
-      integrate_cell_bilinear_form (fv,
-                                    cell,
+      integrate_cell_bilinear_form (ic,
                                     local_mat,
                                     i_dir,
                                     g,
-                                    streaming_at_qp,
-                                    collision_at_qp);
-
-      if (is_cell_at_bd[ic])
-        for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
-          if (cell->at_boundary(fn))
-          {
-            fvf->reinit (cell, fn);
-            integrate_boundary_bilinear_form (fvf,
-                                              cell,
-                                              fn,
-                                              local_mat,
-                                              i_dir,
-                                              g);
-          }
-      
-      if (k==0)
-        for (unsigned int qi=0; qi<n_q; ++qi)
-          for (unsigned int i=0; i<dofs_per_cell; ++i)
-            vec_test_at_qp[ic](qi, i) = fv->shape_value (i,qi) * fv->JxW (qi);
-      
-      vec_ho_sys[k]->add (local_dof_indices,
-                          local_dof_indices,
-                          local_mat);
+                                    cell_streaming,
+                                    cell_collision);
+      integrate_boundary_faces_of_cell (ic, local_mat, i_dir, g);
+      add_to_ho_matrix (k, cell_matrix_offsets[ic],
+                        cell_dof_indices[ic],
+                        cell_dof_indices[ic],
+                        local_mat);
     }
+    if (do_measure_cell_costs)
+      measured_cell_costs[ic] += MPI_Wtime () - t0;
+  }
+  for (unsigned int k=0; k<n_ho_sys; ++k)
     vec_ho_sys[k]->compress (VectorOperation::add);
-  }// components
 }
 
 // The following is a virtual function for integraing cell bilinear form;
@@ -411,8 +1319,7 @@ pre_assemble_cell_matrices
 // It must be overriden
 template <int dim>
 void TransportBase<dim>::integrate_cell_bilinear_form
-(const std_cxx11::shared_ptr<FEValues<dim> > fv,
- typename DoFHandler<dim>::active_cell_iterator &cell,
+(unsigned int &ic,/*local cell index*/
  FullMatrix<double> &cell_matrix,
  unsigned int &i_dir,
  unsigned int &g,
@@ -426,7 +1333,7 @@ void TransportBase<dim>::integrate_cell_bilinear_form
 template <int dim>
 void TransportBase<dim>::integrate_boundary_bilinear_form
 (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
- typename DoFHandler<dim>::active_cell_iterator &cell,
+ unsigned int &ic,/*local cell index*/
  unsigned int &fn,/*face number*/
  FullMatrix<double> &cell_matrix,
  unsigned int &i_dir,
@@ -437,7 +1344,7 @@ void TransportBase<dim>::integrate_boundary_bilinear_form
 template <int dim>
 void TransportBase<dim>::integrate_reflective_boundary_linear_form
 (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
- typename DoFHandler<dim>::active_cell_iterator &cell,
+ unsigned int &ic,/*local cell index*/
  unsigned int &fn,/*face number*/
  std::vector<Vector<double> > &cell_rhses,
  unsigned int &i_dir,
@@ -445,63 +1352,73 @@ void TransportBase<dim>::integrate_reflective_boundary_linear_form
 {// this is a virtual function
 }
 
+template <int dim>
+void TransportBase<dim>::add_reflective_coupling_source
+(const std::vector<unsigned int> &components)
+{// this is a virtual function
+}
+
 template <int dim>
 void TransportBase<dim>::assemble_ho_interface ()
 {
+  Profiler::Scope scope (profiler, "assemble_ho_interface");
   FullMatrix<double> vp_up (dofs_per_cell, dofs_per_cell);
   FullMatrix<double> vp_un (dofs_per_cell, dofs_per_cell);
   FullMatrix<double> vn_up (dofs_per_cell, dofs_per_cell);
   FullMatrix<double> vn_un (dofs_per_cell, dofs_per_cell);
 
-  for (unsigned int k=0; k<n_total_ho_vars; ++k)
+  // face values are set up once per face for all components, and a face is
+  // timed once per assembly for measured costs
+  for (unsigned int i_face=0; i_face<interior_faces.size(); ++i_face)
   {
-    unsigned int g = get_component_group (k);
-    unsigned int i_dir = get_component_direction (k);
-
-    for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+    unsigned int ic = interior_faces[i_face].first;
+    unsigned int fn = interior_faces[i_face].second;
+    const std::vector<types::global_dof_index> &neigh_dofs =
+    interior_face_neighbor_dof_indices[i_face];
+    const double t0 = (do_measure_cell_costs ? MPI_Wtime () : 0.0);
+    fvf->reinit (local_cells[ic], fn);
+    std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fv_nei =
+    reinit_neighbor_face_values (i_face);
+
+    for (unsigned int k=0; k<n_ho_sys; ++k)
     {
-      typename DoFHandler<dim>::active_cell_iterator
-      cell = local_cells[ic];
-      cell->get_dof_indices (local_dof_indices);
-      for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
-        if (!cell->at_boundary(fn) &&
-            cell->neighbor(fn)->id()<cell->id())
-        {
-          fvf->reinit (cell, fn);
-          typename DoFHandler<dim>::cell_iterator
-          neigh = cell->neighbor(fn);
-          neigh->get_dof_indices (neigh_dof_indices);
-          fvf_nei->reinit (neigh, cell->neighbor_face_no(fn));
-
-          vp_up = 0;
-          vp_un = 0;
-          vn_up = 0;
-          vn_un = 0;
-
-          integrate_interface_bilinear_form (fvf, fvf_nei,/*FEFaceValues objects*/
-                                             cell, neigh,/*cell iterators*/
-                                             fn,
-                                             i_dir, g,/*specific component*/
-                                             vp_up, vp_un, vn_up, vn_un);
-          vec_ho_sys[k]->add (local_dof_indices,
-                              local_dof_indices,
-                              vp_up);
-
-          vec_ho_sys[k]->add (local_dof_indices,
-                              neigh_dof_indices,
-                              vp_un);
-
-          vec_ho_sys[k]->add (neigh_dof_indices,
-                              local_dof_indices,
-                              vn_up);
-
-          vec_ho_sys[k]->add (neigh_dof_indices,
-                              neigh_dof_indices,
-                              vn_un);
-        }// target faces
-    }
+      unsigned int g = get_component_group (k);
+      unsigned int i_dir = get_component_direction (k);
+
+      vp_up = 0;
+      vp_un = 0;
+      vn_up = 0;
+      vn_un = 0;
+
+      integrate_interface_bilinear_form (fvf, fv_nei,/*FEFaceValues objects*/
+                                         ic, fn,/*cached cell and face*/
+                                         i_dir, g,/*specific component*/
+                                         vp_up, vp_un, vn_up, vn_un);
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face],
+                        cell_dof_indices[ic],
+                        cell_dof_indices[ic],
+                        vp_up);
+
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+1],
+                        cell_dof_indices[ic],
+                        neigh_dofs,
+                        vp_un);
+
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+2],
+                        neigh_dofs,
+                        cell_dof_indices[ic],
+                        vn_up);
+
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+3],
+                        neigh_dofs,
+                        neigh_dofs,
+                        vn_un);
+    }// component
+    if (do_measure_cell_costs)
+      measured_cell_costs[ic] += MPI_Wtime () - t0;
+  }// interior faces
+  for (unsigned int k=0; k<n_ho_sys; ++k)
     vec_ho_sys[k]->compress(VectorOperation::add);
-  }// component
 }
 
 // The following is a virtual function for integrating DG interface for HO system
@@ -509,9 +1426,8 @@ void TransportBase<dim>::assemble_ho_interface ()
 template <int dim>
 void TransportBase<dim>::integrate_interface_bilinear_form
 (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
- const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf_nei,
- typename DoFHandler<dim>::active_cell_iterator &cell,
- typename DoFHandler<dim>::cell_iterator &neigh,/*cell iterator for cell*/
+ const std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fvf_nei,
+ unsigned int &ic,/*local cell index*/
  unsigned int &fn,/*concerning face number in local cell*/
  unsigned int &i_dir,
  unsigned int &g,
@@ -525,229 +1441,263 @@ void TransportBase<dim>::integrate_interface_bilinear_form
 template <int dim>
 void TransportBase<dim>::initialize_ho_preconditioners ()
 {
+  Profiler::Scope scope (profiler, "initialize_ho_preconditioners");
   radio ("initialize precondiitoners for HO");
+  linear_times.resize (n_ho_sys);
   if (linear_solver_name!="direct")
   {
-    linear_iters.resize (n_total_ho_vars);
+    linear_iters.resize (n_ho_sys);
+    linear_residuals.resize (n_ho_sys);
     if (preconditioner_name=="amg")
-    {
-      pre_ho_amg.resize (n_total_ho_vars);
-      for (unsigned int i=0; i<n_total_ho_vars; ++i)
-      {
-        pre_ho_amg[i] = (std_cxx11::shared_ptr<LA::MPI::PreconditionAMG> (new LA::MPI::PreconditionAMG));
-        LA::MPI::PreconditionAMG::AdditionalData data;
-        if (transport_model_name=="fo" ||
-            (transport_model_name=="ep" && have_reflective_bc))
-          data.symmetric_operator = false;
-        else
-          data.symmetric_operator = true;
-        pre_ho_amg[i]->initialize(*(vec_ho_sys)[i], data);
-      }
-    }
+      pre_ho_amg.resize (n_ho_sys);
     else if (preconditioner_name=="bjacobi")
-    {
-      pre_ho_bjacobi.resize (n_total_ho_vars);
-      for (unsigned int i=0; i<n_total_ho_vars; ++i)
-      {
-        pre_ho_bjacobi[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionBlockJacobi>
-        (new PETScWrappers::PreconditionBlockJacobi);
-        pre_ho_bjacobi[i]->initialize(*(vec_ho_sys)[i]);
-      }
-    }
+      pre_ho_bjacobi.resize (n_ho_sys);
     else if (preconditioner_name=="jacobi")
-    {
-      pre_ho_jacobi.resize (n_total_ho_vars);
-      for (unsigned int i=0; i<n_total_ho_vars; ++i)
-      {
-        pre_ho_jacobi[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionJacobi>
-        (new PETScWrappers::PreconditionJacobi);
-        pre_ho_jacobi[i]->initialize(*(vec_ho_sys)[i]);
-      }
-    }
+      pre_ho_jacobi.resize (n_ho_sys);
     else if (preconditioner_name=="bssor")
-    {
-      pre_ho_eisenstat.resize (n_total_ho_vars);
-      for (unsigned int i=0; i<n_total_ho_vars; ++i)
-      {
-        pre_ho_eisenstat[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionEisenstat>
-        (new PETScWrappers::PreconditionEisenstat);
-        PETScWrappers::PreconditionEisenstat::AdditionalData data(ssor_omega);
-        pre_ho_eisenstat[i]->initialize(*(vec_ho_sys)[i], data);
-      }
-    }
+      pre_ho_eisenstat.resize (n_ho_sys);
     else if (preconditioner_name=="parasails")
-    {
-      pre_ho_parasails.resize (n_total_ho_vars);
-      for (unsigned int i=0; i<n_total_ho_vars; ++i)
-      {
-        pre_ho_parasails[i] = (std_cxx11::shared_ptr<PETScWrappers::PreconditionParaSails>
-                               (new PETScWrappers::PreconditionParaSails));
-        if (transport_model_name=="fo" ||
-            (transport_model_name=="ep" && have_reflective_bc))
-        {
-          PETScWrappers::PreconditionParaSails::AdditionalData data (2);
-          pre_ho_parasails[i]->initialize(*(vec_ho_sys)[i], data);
-        }
-        else
-        {
-          PETScWrappers::PreconditionParaSails::AdditionalData data (1);
-          pre_ho_parasails[i]->initialize(*(vec_ho_sys)[i], data);
-        }
-      }
-    }
+      pre_ho_parasails.resize (n_ho_sys);
   }// not direct solver
   else
   {
-    ho_direct.resize (n_total_ho_vars);
-    direct_init = std::vector<bool> (n_total_ho_vars, false);
+    ho_direct.resize (n_ho_sys);
+    direct_init = std::vector<bool> (n_ho_sys, false);
     gcn = std_cxx11::shared_ptr<SolverControl> (new SolverControl(dof_handler.n_dofs(), 1.0e-15));
   }
+  // PETSc and hypre allocate the hierarchies internally, so the memory is
+  // taken as the growth of the resident set
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats (stats);
+  const double rss_before = stats.VmRSS;
+  for (unsigned int i=0; i<n_ho_sys; ++i)
+    initialize_ho_preconditioner (i);
+  Utilities::System::get_memory_stats (stats);
+  preconditioner_bytes = std::max (0.0, (stats.VmRSS - rss_before) * 1024.0);
+  have_ho_preconditioners = true;
   radio ("initialization finished");
   radio ();
 }
 
+// (Re)builds the preconditioner of HO component i from the current matrix.
+// For the direct solver the factorization is redone on the next solve.
 template <int dim>
-void TransportBase<dim>::ho_solve ()
+void TransportBase<dim>::initialize_ho_preconditioner (unsigned int i)
 {
-  for (unsigned int i=0; i<n_total_ho_vars; ++i)
+  if (linear_solver_name=="direct")
   {
-    SolverControl solver_control (dof_handler.n_dofs(),
-                                  1.0e-15);
-    if (linear_solver_name=="bicgstab" && preconditioner_name=="amg")
-    {
-      PETScWrappers::SolverBicgstab
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_amg)[i]);
-    }
-    else if (linear_solver_name=="cg" && preconditioner_name=="amg")
-    {
-      PETScWrappers::SolverCG
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_amg)[i]);
-    }
-    else if (linear_solver_name=="gmres" && preconditioner_name=="amg")
-    {
-      PETScWrappers::SolverGMRES
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_amg)[i]);
-    }
-    else if (linear_solver_name=="bicgstab" && preconditioner_name=="jacobi")
-    {
-      PETScWrappers::SolverBicgstab
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_jacobi)[i]);
-    }
-    else if (linear_solver_name=="cg" && preconditioner_name=="jacobi")
-    {
-      //radio ("mat",vec_ho_sys[i]->l1_norm());
-      //radio ("rhs",vec_ho_rhs[i]->l1_norm());
-      PETScWrappers::SolverCG
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_jacobi)[i]);
-    }
-    else if (linear_solver_name=="gmres" && preconditioner_name=="jacobi")
-    {
-      PETScWrappers::SolverGMRES
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_jacobi)[i]);
-    }
-    else if (linear_solver_name=="bicgstab" && preconditioner_name=="bssor")
-    {
-      PETScWrappers::SolverBicgstab
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_eisenstat)[i]);
-    }
-    else if (linear_solver_name=="cg" && preconditioner_name=="bssor")
-    {
-      //radio ("mat",vec_ho_sys[i]->l1_norm());
-      //radio ("rhs",vec_ho_rhs[i]->l1_norm());
-      PETScWrappers::SolverCG
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_eisenstat)[i]);
-    }
-    else if (linear_solver_name=="gmres" && preconditioner_name=="bssor")
-    {
-      PETScWrappers::SolverGMRES
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_eisenstat)[i]);
-    }
-    else if (linear_solver_name=="bicgstab" && preconditioner_name=="parasails")
-    {
-      PETScWrappers::SolverBicgstab
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_parasails)[i]);
-    }
-    else if (linear_solver_name=="cg" && preconditioner_name=="parasails")
+    direct_init[i] = false;
+    return;
+  }
+  
+  if (preconditioner_name=="amg")
+  {
+    pre_ho_amg[i] = (std_cxx11::shared_ptr<LA::MPI::PreconditionAMG> (new LA::MPI::PreconditionAMG));
+    LA::MPI::PreconditionAMG::AdditionalData data;
+    if (transport_model_name=="fo" ||
+        (transport_model_name=="ep" && have_reflective_bc &&
+         is_explicit_reflective))
+      data.symmetric_operator = false;
+    else
+      data.symmetric_operator = true;
+    pre_ho_amg[i]->initialize(*(vec_ho_sys)[i], data);
+  }
+  else if (preconditioner_name=="bjacobi")
+  {
+    pre_ho_bjacobi[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionBlockJacobi>
+    (new PETScWrappers::PreconditionBlockJacobi);
+    pre_ho_bjacobi[i]->initialize(*(vec_ho_sys)[i]);
+  }
+  else if (preconditioner_name=="jacobi")
+  {
+    pre_ho_jacobi[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionJacobi>
+    (new PETScWrappers::PreconditionJacobi);
+    pre_ho_jacobi[i]->initialize(*(vec_ho_sys)[i]);
+  }
+  else if (preconditioner_name=="bssor")
+  {
+    pre_ho_eisenstat[i] = std_cxx11::shared_ptr<PETScWrappers::PreconditionEisenstat>
+    (new PETScWrappers::PreconditionEisenstat);
+    PETScWrappers::PreconditionEisenstat::AdditionalData data(ssor_omega);
+    pre_ho_eisenstat[i]->initialize(*(vec_ho_sys)[i], data);
+  }
+  else if (preconditioner_name=="parasails")
+  {
+    pre_ho_parasails[i] = (std_cxx11::shared_ptr<PETScWrappers::PreconditionParaSails>
+                           (new PETScWrappers::PreconditionParaSails));
+    if (transport_model_name=="fo" ||
+        (transport_model_name=="ep" && have_reflective_bc &&
+         is_explicit_reflective))
     {
-      PETScWrappers::SolverCG
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_parasails)[i]);
+      PETScWrappers::PreconditionParaSails::AdditionalData data (2);
+      pre_ho_parasails[i]->initialize(*(vec_ho_sys)[i], data);
     }
-    else if (linear_solver_name=="gmres" && preconditioner_name=="parasails")
+    else
     {
-      PETScWrappers::SolverGMRES
-      solver (solver_control, mpi_communicator);
-      solver.solve (*(vec_ho_sys)[i],
-                    *(vec_aflx)[i],
-                    *(vec_ho_rhs)[i],
-                    *(pre_ho_parasails)[i]);
+      PETScWrappers::PreconditionParaSails::AdditionalData data (1);
+      pre_ho_parasails[i]->initialize(*(vec_ho_sys)[i], data);
     }
-    else if (linear_solver_name=="direct")
+  }
+}
+
+template <int dim>
+void TransportBase<dim>::ho_solve ()
+{
+  Profiler::Scope scope (profiler, "ho_solve");
+  for (unsigned int i=0; i<n_total_ho_vars; ++i)
+    ho_solve_component (i);
+}
+
+template <int dim>
+void TransportBase<dim>::ho_solve_component (unsigned int i)
+{
+  const double t0 = MPI_Wtime ();
+  SolverControl solver_control (dof_handler.n_dofs(),
+                                1.0e-15);
+  if (linear_solver_name=="bicgstab" && preconditioner_name=="amg")
+  {
+    PETScWrappers::SolverBicgstab
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_amg)[i]);
+  }
+  else if (linear_solver_name=="cg" && preconditioner_name=="amg")
+  {
+    PETScWrappers::SolverCG
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_amg)[i]);
+  }
+  else if (linear_solver_name=="gmres" && preconditioner_name=="amg")
+  {
+    PETScWrappers::SolverGMRES
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_amg)[i]);
+  }
+  else if (linear_solver_name=="bicgstab" && preconditioner_name=="jacobi")
+  {
+    PETScWrappers::SolverBicgstab
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_jacobi)[i]);
+  }
+  else if (linear_solver_name=="cg" && preconditioner_name=="jacobi")
+  {
+    //radio ("mat",vec_ho_sys[i]->l1_norm());
+    //radio ("rhs",vec_ho_rhs[i]->l1_norm());
+    PETScWrappers::SolverCG
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_jacobi)[i]);
+  }
+  else if (linear_solver_name=="gmres" && preconditioner_name=="jacobi")
+  {
+    PETScWrappers::SolverGMRES
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_jacobi)[i]);
+  }
+  else if (linear_solver_name=="bicgstab" && preconditioner_name=="bssor")
+  {
+    PETScWrappers::SolverBicgstab
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_eisenstat)[i]);
+  }
+  else if (linear_solver_name=="cg" && preconditioner_name=="bssor")
+  {
+    //radio ("mat",vec_ho_sys[i]->l1_norm());
+    //radio ("rhs",vec_ho_rhs[i]->l1_norm());
+    PETScWrappers::SolverCG
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_eisenstat)[i]);
+  }
+  else if (linear_solver_name=="gmres" && preconditioner_name=="bssor")
+  {
+    PETScWrappers::SolverGMRES
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_eisenstat)[i]);
+  }
+  else if (linear_solver_name=="bicgstab" && preconditioner_name=="parasails")
+  {
+    PETScWrappers::SolverBicgstab
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_parasails)[i]);
+  }
+  else if (linear_solver_name=="cg" && preconditioner_name=="parasails")
+  {
+    PETScWrappers::SolverCG
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_parasails)[i]);
+  }
+  else if (linear_solver_name=="gmres" && preconditioner_name=="parasails")
+  {
+    PETScWrappers::SolverGMRES
+    solver (solver_control, mpi_communicator);
+    solver.solve (*(vec_ho_sys)[i],
+                  *(vec_aflx)[i],
+                  *(vec_ho_rhs)[i],
+                  *(pre_ho_parasails)[i]);
+  }
+  else if (linear_solver_name=="direct")
+  {
+    // The design is we only initialize the solver once such that MUMPS is by
+    // only doing factorization once per PETScMatrix
+    if (!direct_init[i])
     {
-      // The design is we only initialize the solver once such that MUMPS is by
-      // only doing factorization once per PETScMatrix
-      if (!direct_init[i])
-      {
-        ho_direct[i] = std_cxx11::shared_ptr<PETScWrappers::SparseDirectMUMPS>
-        (new PETScWrappers::SparseDirectMUMPS(*gcn, mpi_communicator));
-        if (transport_model_name=="fo" ||
-            (transport_model_name=="ep" && have_reflective_bc))
-          ho_direct[i]->set_symmetric_mode (false);
-        else
-          ho_direct[i]->set_symmetric_mode (true);
-        direct_init[i] = true;
-      }
-      ho_direct[i]->solve (*vec_ho_sys[i],
-                           *vec_aflx[i],
-                           *vec_ho_rhs[i]);
+      ho_direct[i] = std_cxx11::shared_ptr<PETScWrappers::SparseDirectMUMPS>
+      (new PETScWrappers::SparseDirectMUMPS(*gcn, mpi_communicator));
+      if (transport_model_name=="fo" ||
+          (transport_model_name=="ep" && have_reflective_bc &&
+           is_explicit_reflective))
+        ho_direct[i]->set_symmetric_mode (false);
+      else
+        ho_direct[i]->set_symmetric_mode (true);
+      direct_init[i] = true;
     }
-    if (linear_solver_name!="direct")
-      linear_iters[i] = solver_control.last_step ();
-    //pcout << "Solved in " << solver_control.last_step() << std::endl;
+    ho_direct[i]->solve (*vec_ho_sys[i],
+                         *vec_aflx[i],
+                         *vec_ho_rhs[i]);
+  }
+  if (constraints.n_constraints ()>0)
+    constraints.distribute (*vec_aflx[i]);
+  if (linear_solver_name!="direct")
+  {
+    linear_iters[i] = solver_control.last_step ();
+    linear_residuals[i] = solver_control.last_value ();
   }
+  linear_times[i] = MPI_Wtime () - t0;
+  profiler.add_component_solve (i, linear_times[i],
+                                (linear_solver_name!="direct" ?
+                                 solver_control.last_step () : 1));
+  //pcout << "Solved in " << solver_control.last_step() << std::endl;
 }
 
 template <int dim>
@@ -760,7 +1710,8 @@ void TransportBase<dim>::generate_moments ()
     {
       *vec_ho_sflx_old[g] = *vec_ho_sflx[g];
       *vec_ho_sflx[g] = 0;
-      for (unsigned int i_dir=0; i_dir<n_dir; ++i_dir)
+      for (unsigned int i_dir=component_layout.first_direction (g);
+           i_dir<component_layout.end_direction (g); ++i_dir)
         vec_ho_sflx[g]->add (wi[i_dir], *vec_aflx[get_component_index(i_dir, g)]);
       sflx_proc[g] = *vec_ho_sflx[g];
     }
@@ -771,6 +1722,100 @@ void TransportBase<dim>::generate_ho_rhs ()
 {
 }
 
+template <int dim>
+void TransportBase<dim>::assemble_scattering_source
+(const std::vector<Vector<double> > &/*sflxes*/,
+ unsigned int /*g*/,
+ LA::MPI::Vector &/*rhs*/)
+{
+  AssertThrow (false,
+               ExcMessage("angular multigrid is not available for this transport model"));
+}
+
+// Angular multigrid: after a fine sweep the error of the scalar flux solves
+// a transport problem whose source is the scattering of the error plus the
+// sweep's change r = phi - phi_old. That problem is solved approximately
+// with the coarse direction sets and the result corrects the fine flux.
+template <int dim>
+void TransportBase<dim>::angular_multigrid_correction ()
+{
+  Profiler::Scope scope (profiler, "angular_multigrid_correction");
+  std::vector<LA::MPI::Vector> residual, correction;
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    residual.push_back (*vec_ho_sflx[g]);
+    residual[g] -= *vec_ho_sflx_old[g];
+  }
+  angular_multigrid_cycle (0, residual, correction);
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    *vec_ho_sflx[g] += correction[g];
+    sflx_proc[g] = *vec_ho_sflx[g];
+  }
+}
+
+// Coarse level l sweeps its error problem n_mg_sweeps times, Jacobi in
+// groups like the fine source iteration, and after every sweep hands its
+// own change to level l+1 the same way. All directions of a group share the
+// scattering source, so it is assembled once per group. The level's
+// angular fluxes start from zero in every cycle: the lagged reflective
+// partners then only carry sweeps of the current error problem, and a zero
+// residual gives a zero correction.
+template <int dim>
+void TransportBase<dim>::angular_multigrid_cycle
+(unsigned int level,
+ const std::vector<LA::MPI::Vector> &residual,
+ std::vector<LA::MPI::Vector> &correction)
+{
+  correction = residual;
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    correction[g] = 0.0;
+    const unsigned int k_first = mg_first_component[level][g];
+    for (unsigned int k=k_first; k<k_first+mg_n_dir[level][g]; ++k)
+      *vec_aflx[k] = 0.0;
+  }
+  std::vector<LA::MPI::Vector> previous (correction);
+  std::vector<Vector<double> > source (n_group);
+  for (unsigned int sweep=0; sweep<n_mg_sweeps; ++sweep)
+  {
+    for (unsigned int g=0; g<n_group; ++g)
+    {
+      LA::MPI::Vector total (correction[g]);
+      total += residual[g];
+      source[g] = total;
+    }
+    for (unsigned int g=0; g<n_group; ++g)
+    {
+      previous[g] = correction[g];
+      correction[g] = 0.0;
+      const unsigned int k_first = mg_first_component[level][g];
+      assemble_scattering_source (source, g, *vec_ho_rhs[k_first]);
+      std::vector<unsigned int> components (1, k_first);
+      for (unsigned int k=k_first+1; k<k_first+mg_n_dir[level][g]; ++k)
+      {
+        *vec_ho_rhs[k] = *vec_ho_rhs[k_first];
+        components.push_back (k);
+      }
+      add_reflective_coupling_source (components);
+      for (unsigned int k=k_first; k<k_first+mg_n_dir[level][g]; ++k)
+      {
+        ho_solve_component (k);
+        correction[g].add (wi[get_component_direction (k)], *vec_aflx[k]);
+      }
+    }
+    if (level+1<n_mg_levels)
+    {
+      std::vector<LA::MPI::Vector> change (correction), coarse_correction;
+      for (unsigned int g=0; g<n_group; ++g)
+        change[g] -= previous[g];
+      angular_multigrid_cycle (level+1, change, coarse_correction);
+      for (unsigned int g=0; g<n_group; ++g)
+        correction[g] += coarse_correction[g];
+    }
+  }
+}
+
 template <int dim>
 void TransportBase<dim>::NDA_PI ()
 {
@@ -809,6 +1854,14 @@ void TransportBase<dim>::generate_ho_fixed_source ()
 template <int dim>
 void TransportBase<dim>::initialize_fiss_process ()
 {
+  // continue from the flux and keff of the previous solve of this session
+  if (is_warm_start)
+  {
+    for (unsigned int g=0; g<n_group; ++g)
+      sflx_proc[g] = *vec_ho_sflx[g];
+    fission_source = estimate_fiss_source (sflx_proc);
+    return;
+  }
   for (unsigned int g=0; g<n_group; ++g)
   {
     *vec_ho_sflx[g] = 1.0;
@@ -841,16 +1894,21 @@ void TransportBase<dim>::update_fiss_source_keff ()
 template <int dim>
 void TransportBase<dim>::power_iteration ()
 {
+  Profiler::Scope scope (profiler, "power_iteration");
   double err_k = 1.0;
   double err_phi = 1.0;
-  unsigned int ct = 0;
+  unsigned int ct = restart_generation;
   initialize_fiss_process ();
   while (err_k>err_k_tol || err_phi>err_phi_eigen_tol)
   {
     ct += 1;
+    current_generation = ct;
     update_ho_moments_in_fiss ();
     scale_fiss_transfer_matrices ();
-    generate_ho_fixed_source ();
+    {
+      Profiler::Scope scope (profiler, "generate_ho_fixed_source");
+      generate_ho_fixed_source ();
+    }
     source_iteration ();
     update_fiss_source_keff ();
     err_phi = estimate_phi_diff (vec_ho_sflx, vec_ho_sflx_prev_gen);
@@ -859,12 +1917,30 @@ void TransportBase<dim>::power_iteration ()
     << "PI iter: " << ct << ", k: " << keff
     << ", err_k: " << err_k << ", err_phi: " << err_phi << std::endl;
     radio ();
+    if (telemetry.is_enabled ())
+    {
+      TelemetryStream::Record record = telemetry.begin_record ("pi");
+      record.add ("generation", ct);
+      record.add ("iteration", n_si_iterations);
+      record.add ("err_phi", err_phi);
+      record.add ("keff", keff);
+      record.add ("err_k", err_k);
+      telemetry.write_record (record);
+    }
+    if (checkpoint_interval>0 && ct%checkpoint_interval==0)
+      save_checkpoint (ct);
+    if (output_interval>0 && ct%output_interval==0)
+      output_results ("-gen" + Utilities::int_to_string (ct, 4));
   }
+  // the converged state is always kept so it can seed a follow-up run
+  if (checkpoint_interval>0 && ct%checkpoint_interval!=0)
+    save_checkpoint (ct);
 }
 
 template <int dim>
 void TransportBase<dim>::source_iteration ()
 {
+  Profiler::Scope scope (profiler, "source_iteration");
   unsigned int ct = 0;
   double err_phi = 1.0;
   double err_phi_old;
@@ -873,9 +1949,17 @@ void TransportBase<dim>::source_iteration ()
   {
     //generate_ho_source ();
     ct += 1;
-    generate_ho_rhs ();
+    {
+      Profiler::Scope scope (profiler, "generate_ho_rhs");
+      generate_ho_rhs ();
+    }
     ho_solve ();
-    generate_moments ();
+    {
+      Profiler::Scope scope (profiler, "generate_moments");
+      generate_moments ();
+    }
+    if (n_mg_levels>0)
+      angular_multigrid_correction ();
     err_phi_old = err_phi;
     err_phi = estimate_phi_diff (vec_ho_sflx, vec_ho_sflx_old);
     double spectral_radius = err_phi / err_phi_old;
@@ -889,7 +1973,20 @@ void TransportBase<dim>::source_iteration ()
       pcout << ", max lin. sol. iter.: " << *it;
     }
     pcout << std::endl;
+    if (telemetry.is_enabled ())
+    {
+      TelemetryStream::Record record = telemetry.begin_record ("si");
+      record.add ("generation", current_generation);
+      record.add ("iteration", ct);
+      record.add ("err_phi", err_phi);
+      record.add ("spectral_radius", spectral_radius);
+      record.add ("linear_iterations", linear_iters);
+      record.add ("linear_times", linear_times);
+      record.add ("linear_residuals", linear_residuals);
+      telemetry.write_record (record);
+    }
   }
+  n_si_iterations = ct;
   //radio ();
 }
 
@@ -913,23 +2010,20 @@ template <int dim>
 double TransportBase<dim>::estimate_fiss_source (std::vector<Vector<double> > &phis_this_process)
 {
   double fiss_source = 0.0;
+  std::vector<std::vector<double> > local_phis (n_group,
+                                                std::vector<double> (n_q));
   for (unsigned int ic=0; ic<local_cells.size(); ++ic)
   {
-    typename DoFHandler<dim>::active_cell_iterator cell = local_cells[ic];
-    std::vector<std::vector<double> > local_phis (n_group,
-                                                  std::vector<double> (n_q));
-    unsigned int material_id = cell->material_id ();
+    unsigned int material_id = cell_material_ids[ic];
     if (is_material_fissile[material_id])
     {
-      fv->reinit (cell);
       for (unsigned int g=0; g<n_group; ++g)
-        fv->get_function_values (phis_this_process[g],
-                                 local_phis[g]);
+        get_cell_values_at_qp (phis_this_process[g], ic, local_phis[g]);
       for (unsigned int qi=0; qi<n_q; ++qi)
         for (unsigned int g=0; g<n_group; ++g)
           fiss_source += (all_nusigf[material_id][g] *
                           local_phis[g][qi] *
-                          fv->JxW(qi));
+                          cell_jxw[ic][qi]);
     }
   }
   double global_fiss_source = Utilities::MPI::sum (fiss_source, mpi_communicator);
@@ -949,6 +2043,7 @@ double TransportBase<dim>::estimate_phi_diff
 (std::vector<LA::MPI::Vector*> &phis_newer,
  std::vector<LA::MPI::Vector*> &phis_older)
 {
+  Profiler::Scope scope (profiler, "estimate_phi_diff");
   AssertThrow (phis_newer.size ()== phis_older.size (),
                ExcMessage ("n_groups for different phis should be identical"));
   double err = 0.0;
@@ -964,7 +2059,11 @@ double TransportBase<dim>::estimate_phi_diff
 template <int dim>
 void TransportBase<dim>::do_iterations ()
 {
-  initialize_ho_preconditioners ();
+  if (!have_ho_preconditioners)
+  {
+    initialize_ho_preconditioners ();
+    report_memory ();
+  }
   if (is_eigen_problem)
   {
     if (do_nda)
@@ -982,38 +2081,71 @@ void TransportBase<dim>::do_iterations ()
     else
     {
       generate_ho_fixed_source ();
-      generate_moments ();
+      // a warm start keeps the scalar flux it was given
+      if (!is_warm_start)
+        generate_moments ();
       source_iteration ();
       postprocess ();
     }
   }
 }
 
+// Writes the selected group fluxes. tag distinguishes intermediate outputs
+// from the final one. With "vtu-parallel" all processors write one file
+// collectively through MPI-IO; with "vtu" every processor writes its own
+// piece, optionally on a background thread, and rank 0 writes the pvtu
+// record. Patches are built before the thread starts, so the solver may
+// keep changing the fluxes while the piece is written. "gnuplot" writes a
+// text piece per processor that scripts can compare between runs.
 template <int dim>
-void TransportBase<dim>::output_results () const
+void TransportBase<dim>::output_results (const std::string &tag)
 {
-  std::string sec_name = "Graphical output";
-  DataOut<dim> data_out;
-  data_out.attach_dof_handler (dof_handler);
+  if (output_format=="none")
+    return;
+  Profiler::Scope scope (profiler, "output_results");
+  finish_output ();
 
-  for (unsigned int g=0; g<n_group; ++g)
+  std_cxx11::shared_ptr<DataOut<dim> > data_out (new DataOut<dim>);
+  data_out->attach_dof_handler (dof_handler);
+
+  for (unsigned int i=0; i<output_groups.size(); ++i)
   {
     std::ostringstream os;
-    os << "ho_phi_g_" << g;
-    data_out.add_data_vector (sflx_proc[g], os.str ());
+    os << "ho_phi_g_" << output_groups[i];
+    data_out->add_data_vector (sflx_proc[output_groups[i]], os.str ());
+  }
+
+  Vector<float> subdomain;
+  if (do_output_subdomain)
+  {
+    subdomain.reinit (triangulation.n_active_cells ());
+    for (unsigned int i=0; i<subdomain.size(); ++i)
+      subdomain(i) = triangulation.locally_owned_subdomain ();
+    data_out->add_data_vector (subdomain, "subdomain");
   }
 
-  Vector<float> subdomain (triangulation.n_active_cells ());
-  for (unsigned int i=0; i<subdomain.size(); ++i)
-    subdomain(i) = triangulation.locally_owned_subdomain ();
-  data_out.add_data_vector (subdomain, "subdomain");
+  data_out->build_patches ();
 
-  data_out.build_patches ();
+  const std::string name = namebase + "-" + discretization + tag;
+  if (output_format=="gnuplot")
+  {
+    // plain text points and values per processor, for comparing runs
+    std::ofstream output ((name + "-" + Utilities::int_to_string
+                           (triangulation.locally_owned_subdomain (), 4) +
+                           ".gnuplot").c_str ());
+    data_out->write_gnuplot (output);
+    return;
+  }
 
-  const std::string filename = (namebase + "-" + discretization + "-" + Utilities::int_to_string
-                                (triangulation.locally_owned_subdomain (), 4));
-  std::ofstream output ((filename + ".vtu").c_str ());
-  data_out.write_vtu (output);
+  DataOutBase::VtkFlags flags;
+  flags.compression_level = output_compression;
+  data_out->set_flags (flags);
+
+  if (output_format=="vtu-parallel")
+  {
+    data_out->write_vtu_in_parallel ((name + ".vtu").c_str (), mpi_communicator);
+    return;
+  }
 
   if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
   {
@@ -1021,31 +2153,734 @@ void TransportBase<dim>::output_results () const
     for (unsigned int i=0;
          i<Utilities::MPI::n_mpi_processes(mpi_communicator);
          ++i)
-      filenames.push_back (namebase + "-" + discretization + "-" +
+      filenames.push_back (name + "-" +
                            Utilities::int_to_string (i, 4) + ".vtu");
     std::ostringstream os;
-    os << namebase << "-" << discretization << "-" << global_refinements << ".pvtu";
+    os << namebase << "-" << discretization << "-" << global_refinements << tag << ".pvtu";
     std::ofstream master_output ((os.str()).c_str ());
-    data_out.write_pvtu_record (master_output, filenames);
+    data_out->write_pvtu_record (master_output, filenames);
+  }
+
+  const std::string filename = (name + "-" + Utilities::int_to_string
+                                (triangulation.locally_owned_subdomain (), 4) + ".vtu");
+  if (do_background_output)
+    output_thread = std::thread ([data_out, filename] ()
+                                 {
+                                   std::ofstream output (filename.c_str ());
+                                   data_out->write_vtu (output);
+                                 });
+  else
+  {
+    std::ofstream output (filename.c_str ());
+    data_out->write_vtu (output);
   }
 }
 
+// waits for a pending background write
+template <int dim>
+void TransportBase<dim>::finish_output ()
+{
+  if (output_thread.joinable ())
+    output_thread.join ();
+}
+
+// Extra p4est weight of a cell from the cost model, in units where
+// deal.II gives every cell a base weight of 1000: cells with fission or
+// fixed source pay for the source evaluation, boundary faces for their
+// face integrals and DFEM interior faces for the interface terms, split
+// between the two cells sharing them.
+template <int dim>
+unsigned int TransportBase<dim>::get_cost_model_weight
+(const typename Triangulation<dim>::cell_iterator &cell)
+{
+  unsigned int weight = 0;
+  unsigned int mid = cell->material_id ();
+  if ((is_eigen_problem && is_material_fissile[mid]) ||
+      (!is_eigen_problem && mid<all_q.size () &&
+       *std::max_element (all_q[mid].begin (), all_q[mid].end ())>0.0))
+    weight += source_cell_weight;
+  for (unsigned int fn=0; fn<GeometryInfo<dim>::faces_per_cell; ++fn)
+    if (cell->at_boundary (fn))
+      weight += boundary_face_weight;
+    else if (discretization=="dfem")
+      weight += interface_weight / 2;
+  return weight;
+}
+
+// Cell weight callback for repartitioning. With measured costs the weight
+// follows the assembly time of the cell, scaled such that a cell of mean
+// cost weighs as much as the base weight; a refined cell passes its cost to
+// each child and a coarsened parent takes the mean of its children, since
+// the work per cell does not depend on its size.
+template <int dim>
+unsigned int TransportBase<dim>::get_cell_weight
+(const typename Triangulation<dim>::cell_iterator &cell,
+ const typename Triangulation<dim>::CellStatus status)
+{
+  if (load_balancing!="measured" || measured_cell_costs.size ()==0)
+    return get_cost_model_weight (cell);
+  
+  double cost = 0.0;
+  if (status==Triangulation<dim>::CELL_COARSEN)
+  {
+    for (unsigned int i=0; i<cell->n_children(); ++i)
+      cost += measured_cell_costs[cell->child(i)->user_index ()];
+    cost /= cell->n_children ();
+  }
+  else
+    cost = measured_cell_costs[cell->user_index ()];
+  return static_cast<unsigned int>(std::lround (measured_cost_scale * cost));
+}
+
+// Returns the neighbor face values of interior face i_face, reinitialized
+// on the neighbor's face or, for a coarser neighbor, on its subface
+template <int dim>
+std_cxx11::shared_ptr<FEFaceValuesBase<dim> >
+TransportBase<dim>::reinit_neighbor_face_values (unsigned int i_face)
+{
+  if (interior_face_neighbor_subface_numbers[i_face]==numbers::invalid_unsigned_int)
+  {
+    fvf_nei->reinit (interior_face_neighbors[i_face],
+                     interior_face_neighbor_face_numbers[i_face]);
+    return fvf_nei;
+  }
+  fvf_nei_sub->reinit (interior_face_neighbors[i_face],
+                       interior_face_neighbor_face_numbers[i_face],
+                       interior_face_neighbor_subface_numbers[i_face]);
+  return fvf_nei_sub;
+}
+
+// Adapts the mesh to the group scalar fluxes and rebuilds the system on it.
+// The Kelly indicator of each group flux is normalized by the group's
+// largest indicator so that all groups weigh in; the summed indicator drives
+// a fixed-fraction refinement and coarsening. Scalar fluxes are carried to
+// the new mesh and keff is kept, so the next solve starts warm.
+template <int dim>
+void TransportBase<dim>::refine_grid ()
+{
+  Profiler::Scope scope (profiler, "refine_grid");
+  std::vector<std_cxx11::shared_ptr<LA::MPI::Vector> > ghosted_sflx;
+  std::vector<const LA::MPI::Vector*> old_sflx;
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    ghosted_sflx.push_back (std_cxx11::shared_ptr<LA::MPI::Vector>
+                            (new LA::MPI::Vector (local_dofs, relevant_dofs, mpi_communicator)));
+    *ghosted_sflx.back () = *vec_ho_sflx[g];
+    old_sflx.push_back (ghosted_sflx.back ().get ());
+  }
+  
+  Vector<float> indicators (triangulation.n_active_cells ());
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    Vector<float> group_indicators (triangulation.n_active_cells ());
+    KellyErrorEstimator<dim>::estimate (dof_handler,
+                                        *qf_rule,
+                                        typename FunctionMap<dim>::type (),
+                                        *ghosted_sflx[g],
+                                        group_indicators,
+                                        ComponentMask (),
+                                        0,
+                                        numbers::invalid_unsigned_int,
+                                        triangulation.locally_owned_subdomain ());
+    const double max_indicator = Utilities::MPI::max (static_cast<double>(group_indicators.linfty_norm ()),
+                                                      mpi_communicator);
+    if (max_indicator>0.0)
+      indicators.add (1.0 / max_indicator, group_indicators);
+  }
+  
+  parallel::distributed::GridRefinement::
+  refine_and_coarsen_fixed_number (triangulation,
+                                   indicators,
+                                   refine_fraction,
+                                   coarsen_fraction);
+  
+  parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector> sol_trans (dof_handler);
+  triangulation.prepare_coarsening_and_refinement ();
+  sol_trans.prepare_for_coarsening_and_refinement (old_sflx);
+  triangulation.execute_coarsening_and_refinement ();
+  
+  clear_system ();
+  msh_ptr->get_relevant_cell_iterators (dof_handler,
+                                        local_cells,
+                                        ref_bd_cells,
+                                        is_cell_at_bd,
+                                        is_cell_at_ref_bd,
+                                        interior_faces,
+                                        interior_face_neighbors,
+                                        interior_face_neighbor_face_numbers,
+                                        interior_face_neighbor_subface_numbers,
+                                        vacuum_faces,
+                                        reflective_faces,
+                                        reflective_face_boundary_ids);
+  setup_system ();
+  
+  sol_trans.interpolate (vec_ho_sflx);
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    if (constraints.n_constraints ()>0)
+      constraints.distribute (*vec_ho_sflx[g]);
+    sflx_proc[g] = *vec_ho_sflx[g];
+  }
+  
+  report_system ();
+  assemble_ho_system ();
+  have_ho_preconditioners = false;
+  is_warm_start = true;
+}
+
+// Releases everything built on the current mesh: matrices, vectors, the
+// cell and face lists and caches. The element and material data are kept.
+template <int dim>
+void TransportBase<dim>::clear_system ()
+{
+  // sharing matrices go before vec_ho_sys[0], which owns their structure
+  std::vector<std::vector<LA::MPI::SparseMatrix*>*> matrices;
+  matrices.push_back (&vec_lo_sys);
+  matrices.push_back (&vec_ho_sys);
+  for (unsigned int i=0; i<matrices.size(); ++i)
+  {
+    for (unsigned int j=matrices[i]->size(); j>0; --j)
+      delete (*matrices[i])[j-1];
+    matrices[i]->clear ();
+  }
+  
+  std::vector<std::vector<LA::MPI::Vector*>*> vectors;
+  vectors.push_back (&vec_aflx);
+  vectors.push_back (&vec_ho_rhs);
+  vectors.push_back (&vec_ho_fixed_rhs);
+  vectors.push_back (&vec_ho_sflx);
+  vectors.push_back (&vec_ho_sflx_old);
+  vectors.push_back (&vec_ho_sflx_prev_gen);
+  vectors.push_back (&vec_lo_rhs);
+  vectors.push_back (&vec_lo_fixed_rhs);
+  vectors.push_back (&vec_lo_sflx);
+  vectors.push_back (&vec_lo_sflx_old);
+  vectors.push_back (&vec_lo_sflx_prev_gen);
+  for (unsigned int i=0; i<vectors.size(); ++i)
+  {
+    for (unsigned int j=0; j<vectors[i]->size(); ++j)
+      delete (*vectors[i])[j];
+    vectors[i]->clear ();
+  }
+  
+  pre_ho_amg.clear ();
+  pre_ho_bjacobi.clear ();
+  pre_ho_parasails.clear ();
+  pre_ho_jacobi.clear ();
+  pre_ho_eisenstat.clear ();
+  ho_direct.clear ();
+  
+  local_cells.clear ();
+  ref_bd_cells.clear ();
+  is_cell_at_bd.clear ();
+  is_cell_at_ref_bd.clear ();
+  interior_faces.clear ();
+  interior_face_neighbors.clear ();
+  interior_face_neighbor_face_numbers.clear ();
+  interior_face_neighbor_subface_numbers.clear ();
+  interior_face_neighbor_dof_indices.clear ();
+  vacuum_faces.clear ();
+  reflective_faces.clear ();
+  reflective_face_boundary_ids.clear ();
+  
+  cell_dof_indices.clear ();
+  cell_material_ids.clear ();
+  cell_jxw.clear ();
+  cell_measures.clear ();
+  face_measures.clear ();
+  face_normals.clear ();
+  face_boundary_ids.clear ();
+  face_neighbor_indices.clear ();
+  face_neighbor_material_ids.clear ();
+  face_neighbor_measures.clear ();
+  cell_shape_classes.clear ();
+  shape_class_representatives.clear ();
+  cell_matrix_offsets.clear ();
+  interface_matrix_offsets.clear ();
+  vec_test_at_qp.clear ();
+  measured_cell_costs.clear ();
+}
+
+// Writes scalar fluxes, optionally angular fluxes, and the mesh through
+// Triangulation::save, so a restart may use a different number of
+// processors. keff and counters go to a small text file written by rank 0.
+template <int dim>
+void TransportBase<dim>::save_checkpoint (unsigned int generation)
+{
+  Profiler::Scope scope (profiler, "save_checkpoint");
+  std::vector<std_cxx11::shared_ptr<LA::MPI::Vector> > ghosted_vectors;
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    ghosted_vectors.push_back (std_cxx11::shared_ptr<LA::MPI::Vector>
+                               (new LA::MPI::Vector (local_dofs, relevant_dofs, mpi_communicator)));
+    *ghosted_vectors.back () = *vec_ho_sflx[g];
+  }
+  if (do_checkpoint_aflx)
+    for (unsigned int k=0; k<n_total_ho_vars; ++k)
+    {
+      ghosted_vectors.push_back (std_cxx11::shared_ptr<LA::MPI::Vector>
+                                 (new LA::MPI::Vector (local_dofs, relevant_dofs, mpi_communicator)));
+      *ghosted_vectors.back () = *vec_aflx[k];
+    }
+  std::vector<const LA::MPI::Vector*> saved_vectors;
+  for (unsigned int i=0; i<ghosted_vectors.size(); ++i)
+    saved_vectors.push_back (ghosted_vectors[i].get ());
+  
+  parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector> sol_trans (dof_handler);
+  sol_trans.prepare_serialization (saved_vectors);
+  triangulation.save ((checkpoint_namebase + ".mesh").c_str ());
+  
+  if (Utilities::MPI::this_mpi_process (mpi_communicator)==0)
+  {
+    std::ofstream state ((checkpoint_namebase + ".state").c_str ());
+    state << std::setprecision (17)
+    << "generation " << generation << std::endl
+    << "keff " << keff << std::endl
+    << "fission_source " << fission_source << std::endl
+    << "refinements " << global_refinements << std::endl
+    << "groups " << n_group << std::endl
+    << "angular_fluxes " << (do_checkpoint_aflx ? 1 : 0) << std::endl
+    << "components " << n_total_ho_vars << std::endl;
+  }
+  radio ("Checkpoint written at generation", generation);
+}
+
+// Restores the saved mesh and fluxes. If the input asks for more uniform
+// refinements than the checkpoint has, the fluxes are interpolated onto the
+// finer mesh and serve as the initial guess. The data is held in
+// restart_vectors until apply_checkpoint () copies it into the system.
+template <int dim>
+void TransportBase<dim>::load_checkpoint ()
+{
+  std::map<std::string, double> state;
+  {
+    std::ifstream fin ((checkpoint_namebase + ".state").c_str ());
+    AssertThrow (fin.good (),
+                 ExcMessage("cannot open " + checkpoint_namebase + ".state"));
+    std::string name;
+    double value;
+    while (fin >> name >> value)
+      state[name] = value;
+  }
+  AssertThrow (static_cast<unsigned int>(state["groups"])==n_group,
+               ExcMessage("checkpoint has a different number of groups"));
+  const unsigned int saved_refinements = static_cast<unsigned int>(state["refinements"]);
+  AssertThrow (global_refinements>=saved_refinements,
+               ExcMessage("restart cannot use fewer refinements than the checkpoint"));
+  const bool have_saved_aflx = state["angular_fluxes"]>0.0;
+  const bool use_saved_aflx = (have_saved_aflx &&
+                               static_cast<unsigned int>(state["components"])==n_total_ho_vars &&
+                               saved_refinements==global_refinements);
+  keff = state["keff"];
+  restart_generation = static_cast<unsigned int>(state["generation"]);
+  
+  msh_ptr->make_coarse_grid (triangulation);
+  triangulation.load ((checkpoint_namebase + ".mesh").c_str ());
+  
+  std_cxx11::shared_ptr<FiniteElement<dim> > restart_fe;
+  if (discretization=="dfem")
+    restart_fe = std_cxx11::shared_ptr<FiniteElement<dim> > (new FE_DGQ<dim> (p_order));
+  else
+    restart_fe = std_cxx11::shared_ptr<FiniteElement<dim> > (new FE_Q<dim> (p_order));
+  dof_handler.distribute_dofs (*restart_fe);
+  
+  // all saved vectors have to be read back, even the ones not used
+  const unsigned int n_saved = n_group + (have_saved_aflx ?
+                                          static_cast<unsigned int>(state["components"]) : 0);
+  restart_vectors.resize (n_saved);
+  std::vector<LA::MPI::Vector*> loaded_vectors (n_saved);
+  for (unsigned int i=0; i<n_saved; ++i)
+  {
+    restart_vectors[i] = std_cxx11::shared_ptr<LA::MPI::Vector>
+    (new LA::MPI::Vector (dof_handler.locally_owned_dofs (), mpi_communicator));
+    loaded_vectors[i] = restart_vectors[i].get ();
+  }
+  {
+    parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector> sol_trans (dof_handler);
+    sol_trans.deserialize (loaded_vectors);
+  }
+  if (!use_saved_aflx)
+    restart_vectors.resize (n_group);
+  
+  for (unsigned int r=saved_refinements; r<global_refinements; ++r)
+    transfer_restart_vectors (*restart_fe, true);
+  
+  // Balance with the cell weights here rather than in setup (): the fluxes
+  // have to move with their cells before the system is built on the new
+  // partition
+  if (load_balancing!="none")
+    transfer_restart_vectors (*restart_fe, false);
+  
+  // setup_system () distributes DoFs again with the same element, which
+  // reproduces this numbering
+  dof_handler.clear ();
+  radio ("Restarting from generation", restart_generation);
+}
+
+// Moves restart_vectors through one global refinement (refine) or one
+// repartition with the current cell weights, and distributes DoFs of
+// restart_fe on the new mesh.
+template <int dim>
+void TransportBase<dim>::transfer_restart_vectors (const FiniteElement<dim> &restart_fe,
+                                                   bool refine)
+{
+  IndexSet owned_dofs = dof_handler.locally_owned_dofs ();
+  IndexSet ghosted_dofs;
+  DoFTools::extract_locally_relevant_dofs (dof_handler, ghosted_dofs);
+  std::vector<std_cxx11::shared_ptr<LA::MPI::Vector> > ghosted_vectors;
+  std::vector<const LA::MPI::Vector*> old_vectors;
+  for (unsigned int i=0; i<restart_vectors.size(); ++i)
+  {
+    ghosted_vectors.push_back (std_cxx11::shared_ptr<LA::MPI::Vector>
+                               (new LA::MPI::Vector (owned_dofs, ghosted_dofs, mpi_communicator)));
+    *ghosted_vectors.back () = *restart_vectors[i];
+    old_vectors.push_back (ghosted_vectors.back ().get ());
+  }
+  
+  parallel::distributed::SolutionTransfer<dim, LA::MPI::Vector> sol_trans (dof_handler);
+  if (refine)
+  {
+    for (typename Triangulation<dim>::active_cell_iterator
+         cell=triangulation.begin_active(); cell!=triangulation.end(); ++cell)
+      if (cell->is_locally_owned ())
+        cell->set_refine_flag ();
+    triangulation.prepare_coarsening_and_refinement ();
+    sol_trans.prepare_for_coarsening_and_refinement (old_vectors);
+    triangulation.execute_coarsening_and_refinement ();
+  }
+  else
+  {
+    sol_trans.prepare_for_coarsening_and_refinement (old_vectors);
+    triangulation.repartition ();
+  }
+  
+  dof_handler.distribute_dofs (restart_fe);
+  std::vector<LA::MPI::Vector*> new_vectors;
+  for (unsigned int i=0; i<restart_vectors.size(); ++i)
+  {
+    restart_vectors[i] = std_cxx11::shared_ptr<LA::MPI::Vector>
+    (new LA::MPI::Vector (dof_handler.locally_owned_dofs (), mpi_communicator));
+    new_vectors.push_back (restart_vectors[i].get ());
+  }
+  sol_trans.interpolate (new_vectors);
+}
+
+template <int dim>
+void TransportBase<dim>::apply_checkpoint ()
+{
+  for (unsigned int g=0; g<n_group; ++g)
+  {
+    *vec_ho_sflx[g] = *restart_vectors[g];
+    sflx_proc[g] = *vec_ho_sflx[g];
+  }
+  if (restart_vectors.size()>n_group)
+    for (unsigned int k=0; k<n_total_ho_vars; ++k)
+      *vec_aflx[k] = *restart_vectors[n_group+k];
+  restart_vectors.clear ();
+  is_warm_start = true;
+}
+
 template <int dim>
 void TransportBase<dim>::run ()
 {
+  {
+    Profiler::Scope scope (profiler, "run");
+    setup ();
+    solve ();
+    for (unsigned int cycle=0; cycle<n_refinement_cycles; ++cycle)
+    {
+      radio ("Adaptive refinement cycle", cycle+1);
+      refine_grid ();
+      solve ();
+    }
+    output_results ("");
+    finish_output ();
+  }
+  profiler.write_json (namebase + "-profile.json");
+}
+
+template <int dim>
+void TransportBase<dim>::setup ()
+{
+  Profiler::Scope scope (profiler, "setup");
   radio ("making grid");
-  msh_ptr->make_grid (triangulation);
+  if (do_restart)
+    load_checkpoint ();
+  else
+    msh_ptr->make_grid (triangulation);
+  // a restart is balanced inside load_checkpoint () together with its fluxes
+  if (load_balancing!="none" && !do_restart)
+    triangulation.repartition ();
   msh_ptr->get_relevant_cell_iterators (dof_handler,
                                         local_cells,
                                         ref_bd_cells,
                                         is_cell_at_bd,
-                                        is_cell_at_ref_bd);
+                                        is_cell_at_ref_bd,
+                                        interior_faces,
+                                        interior_face_neighbors,
+                                        interior_face_neighbor_face_numbers,
+                                        interior_face_neighbor_subface_numbers,
+                                        vacuum_faces,
+                                        reflective_faces,
+                                        reflective_face_boundary_ids);
   //msh_ptr.reset ();
   setup_system ();
+  if (do_restart)
+    apply_checkpoint ();
   report_system ();
   assemble_ho_system ();
+}
+
+// Solves with the current system. Every solve after the first one in a
+// session starts from the previous flux and keff.
+template <int dim>
+void TransportBase<dim>::solve ()
+{
+  Profiler::Scope scope (profiler, "solve");
   do_iterations ();
-  output_results();
+  is_warm_start = true;
+}
+
+template <int dim>
+double TransportBase<dim>::get_keff () const
+{
+  return keff;
+}
+
+// Replaces the cross sections of an assembled session. Mesh, DoFs, caches
+// and the sparsity structure are kept: only cells whose material changed
+// sigma_t in some group, and the interior faces next to them, are
+// reassembled by subtracting their old local matrices and adding the new
+// ones. Preconditioners are rebuilt for the affected groups only.
+template <int dim>
+void TransportBase<dim>::update_material_properties
+(std_cxx11::shared_ptr<MaterialProperties> new_mat_ptr)
+{
+  AssertThrow (new_mat_ptr->get_n_material ()==n_material &&
+               new_mat_ptr->get_n_group ()==n_group,
+               ExcMessage("updated materials must keep material and group counts"));
+  
+  // materials and groups whose HO operator changes; the scattering, fission
+  // and source data only enter the right hand sides
+  std::vector<std::vector<double> > new_sigt = new_mat_ptr->get_sigma_t ();
+  std::vector<std::vector<double> > new_inv_sigt = new_mat_ptr->get_inv_sigma_t ();
+  std::vector<std::vector<bool> > is_changed (n_material, std::vector<bool> (n_group, false));
+  std::vector<bool> is_group_changed (n_group, false);
+  for (unsigned int m=0; m<n_material; ++m)
+    for (unsigned int g=0; g<n_group; ++g)
+      if (new_sigt[m][g]!=all_sigt[m][g] ||
+          new_inv_sigt[m][g]!=all_inv_sigt[m][g])
+      {
+        is_changed[m][g] = true;
+        is_group_changed[g] = true;
+      }
+  
+  std::vector<bool> is_material_changed (n_material, false);
+  for (unsigned int m=0; m<n_material; ++m)
+    is_material_changed[m] = (std::find (is_changed[m].begin (),
+                                         is_changed[m].end (),
+                                         true)!=is_changed[m].end ());
+  
+  std::vector<unsigned int> changed_cells;
+  for (unsigned int ic=0; ic<local_cells.size(); ++ic)
+    if (is_material_changed[cell_material_ids[ic]])
+      changed_cells.push_back (ic);
+  
+  std::vector<unsigned int> changed_faces;
+  for (unsigned int i_face=0; i_face<interior_faces.size(); ++i_face)
+  {
+    unsigned int f = (interior_faces[i_face].first *
+                      GeometryInfo<dim>::faces_per_cell +
+                      interior_faces[i_face].second);
+    if (is_material_changed[cell_material_ids[interior_faces[i_face].first]] ||
+        is_material_changed[face_neighbor_material_ids[f]])
+      changed_faces.push_back (i_face);
+  }
+  
+  unsigned int n_changed_cells = changed_cells.size ();
+  radio ("Cells with changed materials",
+         Utilities::MPI::sum (n_changed_cells, mpi_communicator));
+  
+  // subtract-and-add updates accumulate round-off, so every
+  // full_reassembly_interval-th update rebuilds all HO matrices instead
+  ++n_material_updates;
+  if (full_reassembly_interval>0 &&
+      n_material_updates%full_reassembly_interval==0)
+  {
+    radio ("Full HO reassembly after material update", n_material_updates);
+    mat_ptr = new_mat_ptr;
+    load_material_data ();
+    for (unsigned int k=0; k<n_ho_sys; ++k)
+      *vec_ho_sys[k] = 0;
+    assemble_ho_system ();
+    if (have_ho_preconditioners)
+      for (unsigned int k=0; k<n_ho_sys; ++k)
+        initialize_ho_preconditioner (k);
+    return;
+  }
+  
+  add_ho_cell_contributions (changed_cells, is_changed, -1.0);
+  if (discretization=="dfem")
+    add_ho_interface_contributions (changed_faces, is_changed, -1.0);
+  
+  mat_ptr = new_mat_ptr;
+  load_material_data ();
+  
+  add_ho_cell_contributions (changed_cells, is_changed, 1.0);
+  if (discretization=="dfem")
+    add_ho_interface_contributions (changed_faces, is_changed, 1.0);
+  
+  // the change pattern is the same on all processors, so compress() is
+  // called collectively
+  for (unsigned int k=0; k<n_ho_sys; ++k)
+    if (is_group_changed[get_component_group (k)])
+    {
+      vec_ho_sys[k]->compress (VectorOperation::add);
+      if (have_ho_preconditioners)
+        initialize_ho_preconditioner (k);
+    }
+}
+
+// Adds factor times the cell and boundary face matrices of the listed local
+// cells to the HO matrices of the groups changed for the cell material.
+// Shape-class cells are pre-assembled once per class on its representative,
+// exactly as in assemble_ho_volume_boundary, so a subtraction cancels the
+// original; unclassified cells are pre-assembled one at a time.
+template <int dim>
+void TransportBase<dim>::add_ho_cell_contributions
+(const std::vector<unsigned int> &cells,
+ const std::vector<std::vector<bool> > &is_changed,
+ double factor)
+{
+  std::vector<std::vector<FullMatrix<double> > >
+  cell_streaming_at_qp (n_q, std::vector<FullMatrix<double> > (n_dir, FullMatrix<double> (dofs_per_cell, dofs_per_cell)));
+  std::vector<FullMatrix<double> >
+  cell_collision_at_qp (n_q, FullMatrix<double>(dofs_per_cell, dofs_per_cell));
+  FullMatrix<double> local_mat (dofs_per_cell, dofs_per_cell);
+  
+  // cells of each shape class, unclassified cells under invalid_unsigned_int
+  std::map<unsigned int, std::vector<unsigned int> > cells_of_class;
+  for (unsigned int i=0; i<cells.size(); ++i)
+    cells_of_class[cell_shape_classes[cells[i]]].push_back (cells[i]);
+  
+  for (std::map<unsigned int, std::vector<unsigned int> >::iterator
+       it=cells_of_class.begin (); it!=cells_of_class.end (); ++it)
+  {
+    const bool is_classified = (it->first!=numbers::invalid_unsigned_int);
+    if (is_classified)
+    {
+      typename DoFHandler<dim>::active_cell_iterator cell =
+      local_cells[shape_class_representatives[it->first]];
+      fv->reinit (cell);
+      pre_assemble_cell_matrices (fv, cell, cell_streaming_at_qp, cell_collision_at_qp);
+    }
+    
+    for (unsigned int i=0; i<it->second.size(); ++i)
+    {
+      unsigned int ic = it->second[i];
+      unsigned int mid = cell_material_ids[ic];
+      if (!is_classified)
+      {
+        fv->reinit (local_cells[ic]);
+        pre_assemble_cell_matrices (fv, local_cells[ic],
+                                    cell_streaming_at_qp, cell_collision_at_qp);
+      }
+      for (unsigned int k=0; k<n_ho_sys; ++k)
+      {
+        unsigned int g = get_component_group (k);
+        unsigned int i_dir = get_component_direction (k);
+        if (!is_changed[mid][g])
+          continue;
+        local_mat = 0;
+        integrate_cell_bilinear_form (ic,
+                                      local_mat,
+                                      i_dir,
+                                      g,
+                                      cell_streaming_at_qp,
+                                      cell_collision_at_qp);
+        integrate_boundary_faces_of_cell (ic, local_mat, i_dir, g);
+        local_mat *= factor;
+        add_to_ho_matrix (k, cell_matrix_offsets[ic],
+                          cell_dof_indices[ic],
+                          cell_dof_indices[ic],
+                          local_mat);
+      }
+    }
+  }
+}
+
+template <int dim>
+void TransportBase<dim>::add_ho_interface_contributions
+(const std::vector<unsigned int> &faces,
+ const std::vector<std::vector<bool> > &is_changed,
+ double factor)
+{
+  FullMatrix<double> vp_up (dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> vp_un (dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> vn_up (dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> vn_un (dofs_per_cell, dofs_per_cell);
+  
+  for (unsigned int i=0; i<faces.size(); ++i)
+  {
+    unsigned int i_face = faces[i];
+    unsigned int ic = interior_faces[i_face].first;
+    unsigned int fn = interior_faces[i_face].second;
+    unsigned int mid = cell_material_ids[ic];
+    unsigned int mid_nei =
+    face_neighbor_material_ids[ic*GeometryInfo<dim>::faces_per_cell+fn];
+    const std::vector<types::global_dof_index> &neigh_dofs =
+    interior_face_neighbor_dof_indices[i_face];
+    fvf->reinit (local_cells[ic], fn);
+    std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fv_nei =
+    reinit_neighbor_face_values (i_face);
+    
+    for (unsigned int k=0; k<n_ho_sys; ++k)
+    {
+      unsigned int g = get_component_group (k);
+      unsigned int i_dir = get_component_direction (k);
+      if (!is_changed[mid][g] && !is_changed[mid_nei][g])
+        continue;
+      
+      vp_up = 0;
+      vp_un = 0;
+      vn_up = 0;
+      vn_un = 0;
+      integrate_interface_bilinear_form (fvf, fv_nei,
+                                         ic, fn,
+                                         i_dir, g,
+                                         vp_up, vp_un, vn_up, vn_un);
+      vp_up *= factor;
+      vp_un *= factor;
+      vn_up *= factor;
+      vn_un *= factor;
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face],
+                        cell_dof_indices[ic], cell_dof_indices[ic], vp_up);
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+1],
+                        cell_dof_indices[ic], neigh_dofs, vp_un);
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+2],
+                        neigh_dofs, cell_dof_indices[ic], vn_up);
+      add_to_ho_matrix (k, interface_matrix_offsets[4*i_face+3],
+                        neigh_dofs, neigh_dofs, vn_un);
+    }
+  }
+}
+
+// evaluate a process-wide finite element field at the quadrature points of a
+// local cell from the cached DoF indices and reference shape values
+template <int dim>
+void TransportBase<dim>::get_cell_values_at_qp
+(const Vector<double> &global_values,
+ unsigned int ic,
+ std::vector<double> &values_at_qp)
+{
+  const std::vector<types::global_dof_index> &dofs = cell_dof_indices[ic];
+  for (unsigned int qi=0; qi<n_q; ++qi)
+  {
+    double val = 0.0;
+    for (unsigned int j=0; j<dofs_per_cell; ++j)
+      val += ref_shape_values(qi,j) * global_values(dofs[j]);
+    values_at_qp[qi] = val;
+  }
 }
 
 // wrapper functions used to retrieve info from various Hash tables
@@ -1054,20 +2889,20 @@ unsigned int TransportBase<dim>::get_component_index
 (unsigned int incident_angle_index, unsigned int g)
 {
   // retrieve component indecis given direction and group
-  // must be used after initializing the index map
-  return component_index[std::make_pair (incident_angle_index, g)];
+  // must be used after initializing the component layout
+  return component_layout.index (incident_angle_index, g);
 }
 
 template <int dim>
 unsigned int TransportBase<dim>::get_component_direction (unsigned int comp_ind)
 {
-  return inverse_component_index[comp_ind].first;
+  return component_layout.direction (comp_ind);
 }
 
 template <int dim>
 unsigned int TransportBase<dim>::get_component_group (unsigned int comp_ind)
 {
-  return inverse_component_index[comp_ind].second;
+  return component_layout.group (comp_ind);
 }
 
 template <int dim>
@@ -1080,6 +2915,20 @@ unsigned int TransportBase<dim>::get_reflective_direction_index
                                                     incident_angle_index)];
 }
 
+// Component holding the reflection of component k's direction on the given
+// boundary. Coarse angular multigrid components of a group hold consecutive
+// catalog directions, so their partner is found by the direction offset.
+template <int dim>
+unsigned int TransportBase<dim>::get_reflected_component (unsigned int k,
+                                                          unsigned int boundary_id)
+{
+  const unsigned int i_dir = get_component_direction (k);
+  const unsigned int r_dir = get_reflective_direction_index (boundary_id, i_dir);
+  if (k<n_total_ho_vars)
+    return get_component_index (r_dir, get_component_group (k));
+  return k - i_dir + r_dir;
+}
+
 //functions used to cout information for diagonose or just simply cout
 template <int dim>
 void TransportBase<dim>::radio (std::string str)
@@ -1,6 +1,329 @@
 #include "../../../include/transport/base/transport_base.h"
 #include "../../../include/transport/derived/even_parity.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#if defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  // row[j] += ((a*x[j] + b*x[j]) + c*y[j]) * w for j<n, using AVX-512 and
+  // AVX lanes when the compiler targets them and scalar code otherwise. Every
+  // lane performs the same operations in the same order as the scalar loop.
+  template <unsigned int n>
+  inline void accumulate_outer_row (double *row,
+                                    const double *x,
+                                    const double *y,
+                                    const double a,
+                                    const double b,
+                                    const double c,
+                                    const double w)
+  {
+    unsigned int j = 0;
+#if defined(__AVX512F__)
+    {
+      const __m512d va = _mm512_set1_pd (a), vb = _mm512_set1_pd (b);
+      const __m512d vc = _mm512_set1_pd (c), vw = _mm512_set1_pd (w);
+      for (; j+8<=n; j+=8)
+      {
+        const __m512d vx = _mm512_loadu_pd (x+j);
+        __m512d t = _mm512_add_pd (_mm512_mul_pd (va, vx), _mm512_mul_pd (vb, vx));
+        t = _mm512_mul_pd (_mm512_add_pd (t, _mm512_mul_pd (vc, _mm512_loadu_pd (y+j))), vw);
+        _mm512_storeu_pd (row+j, _mm512_add_pd (_mm512_loadu_pd (row+j), t));
+      }
+    }
+#endif
+#if defined(__AVX__)
+    {
+      const __m256d va = _mm256_set1_pd (a), vb = _mm256_set1_pd (b);
+      const __m256d vc = _mm256_set1_pd (c), vw = _mm256_set1_pd (w);
+      for (; j+4<=n; j+=4)
+      {
+        const __m256d vx = _mm256_loadu_pd (x+j);
+        __m256d t = _mm256_add_pd (_mm256_mul_pd (va, vx), _mm256_mul_pd (vb, vx));
+        t = _mm256_mul_pd (_mm256_add_pd (t, _mm256_mul_pd (vc, _mm256_loadu_pd (y+j))), vw);
+        _mm256_storeu_pd (row+j, _mm256_add_pd (_mm256_loadu_pd (row+j), t));
+      }
+    }
+#endif
+    for (; j<n; ++j)
+      row[j] += ((a * x[j] + b * x[j]) + c * y[j]) * w;
+  }
+
+  // Even-parity kernels with compile-time sizes for Q_p/DGQ_p elements with
+  // p+1 Gauss points per direction. Shape data are gathered into fixed-size
+  // stack arrays so the (i,j) loops can be unrolled and vectorized. Entries
+  // are accumulated in the same order as the generic loops in EvenParity.
+  template <int dim, int p>
+  struct EPKernel
+  {
+    static const unsigned int n_1d = p + 1;
+    static const unsigned int n_dofs = (dim==2 ? n_1d*n_1d : n_1d*n_1d*n_1d);
+    static const unsigned int n_q = n_dofs;
+    static const unsigned int n_qf = (dim==2 ? n_1d : n_1d*n_1d);
+
+    static void cell
+    (const std::vector<std::vector<FullMatrix<double> > > &streaming_at_qp,
+     const std::vector<FullMatrix<double> > &collision_at_qp,
+     const std::vector<double> &jxw,
+     const unsigned int i_dir,
+     const double inv_sigt,
+     const double sigt,
+     FullMatrix<double> &cell_matrix)
+    {
+      double local[n_dofs][n_dofs] = {};
+      for (unsigned int qi=0; qi<n_q; ++qi)
+      {
+        const double *str = &streaming_at_qp[qi][i_dir](0,0);
+        const double *col = &collision_at_qp[qi](0,0);
+        const double w = jxw[qi];
+        for (unsigned int i=0; i<n_dofs; ++i)
+          for (unsigned int j=0; j<n_dofs; ++j)
+            local[i][j] += (str[i*n_dofs+j] * inv_sigt +
+                            col[i*n_dofs+j] * sigt) * w;
+      }
+      for (unsigned int i=0; i<n_dofs; ++i)
+        for (unsigned int j=0; j<n_dofs; ++j)
+          cell_matrix(i,j) += local[i][j];
+    }
+
+    static void vacuum_boundary
+    (const FEFaceValues<dim> &fvf,
+     const double absndo,
+     FullMatrix<double> &cell_matrix)
+    {
+      double val[n_qf][n_dofs];
+      double jxw[n_qf];
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+      {
+        jxw[qi] = fvf.JxW (qi);
+        for (unsigned int i=0; i<n_dofs; ++i)
+          val[qi][i] = fvf.shape_value (i, qi);
+      }
+
+      double local[n_dofs][n_dofs] = {};
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          const double vi = absndo * val[qi][i];
+          for (unsigned int j=0; j<n_dofs; ++j)
+            local[i][j] += vi * val[qi][j] * jxw[qi];
+        }
+      for (unsigned int i=0; i<n_dofs; ++i)
+        for (unsigned int j=0; j<n_dofs; ++j)
+          cell_matrix(i,j) += local[i][j];
+    }
+
+    static void reflective_boundary
+    (const FEFaceValues<dim> &fvf,
+     const Tensor<1,dim> &ref_angle,
+     const double ndo_inv_sigt,
+     FullMatrix<double> &cell_matrix)
+    {
+      double val[n_qf][n_dofs];
+      double ref_grad[n_qf][n_dofs];
+      double jxw[n_qf];
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+      {
+        jxw[qi] = fvf.JxW (qi);
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          val[qi][i] = fvf.shape_value (i, qi);
+          ref_grad[qi][i] = ref_angle * fvf.shape_grad (i, qi);
+        }
+      }
+
+      double local[n_dofs][n_dofs] = {};
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          const double vi = - ndo_inv_sigt * val[qi][i];
+          for (unsigned int j=0; j<n_dofs; ++j)
+            local[i][j] += vi * ref_grad[qi][j] * jxw[qi];
+        }
+      for (unsigned int i=0; i<n_dofs; ++i)
+        for (unsigned int j=0; j<n_dofs; ++j)
+          cell_matrix(i,j) += local[i][j];
+    }
+
+    // The four DFEM interface blocks as outer-product row updates. Values and
+    // directional derivatives omega*grad are tabulated once per face
+    // quadrature point, and the per-i factors are hoisted so the j loops are
+    // plain streams. Each entry sees the same floating-point operations, in
+    // the same order, as interface_reference, which debug builds check up to
+    // FMA contraction.
+    static void interface
+    (const FEFaceValues<dim> &fvf,
+     const FEFaceValuesBase<dim> &fvf_nei,
+     const Tensor<1,dim> &omega,
+     const double sige,
+     const double half_ndo,
+     const double local_inv_sigt,
+     const double neigh_inv_sigt,
+     FullMatrix<double> &vp_up,
+     FullMatrix<double> &vp_un,
+     FullMatrix<double> &vn_up,
+     FullMatrix<double> &vn_un)
+    {
+      double vp[n_qf][n_dofs], vn[n_qf][n_dofs];
+      double dp[n_qf][n_dofs], dn[n_qf][n_dofs];
+      double jxw[n_qf];
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+      {
+        jxw[qi] = fvf.JxW (qi);
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          vp[qi][i] = fvf.shape_value (i, qi);
+          vn[qi][i] = fvf_nei.shape_value (i, qi);
+          dp[qi][i] = omega * fvf.shape_grad (i, qi);
+          dn[qi][i] = omega * fvf_nei.shape_grad (i, qi);
+        }
+      }
+
+      const double cl = local_inv_sigt * half_ndo;
+      const double cn = neigh_inv_sigt * half_ndo;
+      double pp[n_dofs][n_dofs] = {}, pn[n_dofs][n_dofs] = {};
+      double np[n_dofs][n_dofs] = {}, nn[n_dofs][n_dofs] = {};
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+      {
+        const double w = jxw[qi];
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          accumulate_outer_row<n_dofs> (pp[i], vp[qi], dp[qi],
+                                        sige * vp[qi][i],
+                                        -(cl * dp[qi][i]),
+                                        -(cl * vp[qi][i]), w);
+          accumulate_outer_row<n_dofs> (pn[i], vn[qi], dn[qi],
+                                        -sige * vp[qi][i],
+                                        cl * dp[qi][i],
+                                        -(cn * vp[qi][i]), w);
+          accumulate_outer_row<n_dofs> (np[i], vp[qi], dp[qi],
+                                        -sige * vn[qi][i],
+                                        -(cn * dn[qi][i]),
+                                        cl * vn[qi][i], w);
+          accumulate_outer_row<n_dofs> (nn[i], vn[qi], dn[qi],
+                                        sige * vn[qi][i],
+                                        cn * dn[qi][i],
+                                        cn * vn[qi][i], w);
+        }
+      }
+
+#ifdef DEBUG
+      {
+        FullMatrix<double> ref_pp (n_dofs, n_dofs), ref_pn (n_dofs, n_dofs);
+        FullMatrix<double> ref_np (n_dofs, n_dofs), ref_nn (n_dofs, n_dofs);
+        interface_reference (fvf, fvf_nei, omega, sige, half_ndo,
+                             local_inv_sigt, neigh_inv_sigt,
+                             ref_pp, ref_pn, ref_np, ref_nn);
+        // the compiler may contract either form into FMAs differently, so
+        // entries are compared to a few ulps of the largest block entry
+        double scale = 0.0;
+        for (unsigned int i=0; i<n_dofs; ++i)
+          for (unsigned int j=0; j<n_dofs; ++j)
+            scale = std::max (scale, std::max (std::max (std::fabs (ref_pp(i,j)), std::fabs (ref_pn(i,j))),
+                                               std::max (std::fabs (ref_np(i,j)), std::fabs (ref_nn(i,j)))));
+        const double tol = 8.0 * std::numeric_limits<double>::epsilon () * scale;
+        for (unsigned int i=0; i<n_dofs; ++i)
+          for (unsigned int j=0; j<n_dofs; ++j)
+            Assert (std::fabs (pp[i][j] - ref_pp(i,j))<=tol &&
+                    std::fabs (pn[i][j] - ref_pn(i,j))<=tol &&
+                    std::fabs (np[i][j] - ref_np(i,j))<=tol &&
+                    std::fabs (nn[i][j] - ref_nn(i,j))<=tol,
+                    ExcMessage ("vectorized interface kernel differs from reference"));
+      }
+#endif
+
+      for (unsigned int i=0; i<n_dofs; ++i)
+        for (unsigned int j=0; j<n_dofs; ++j)
+        {
+          vp_up(i,j) += pp[i][j];
+          vp_un(i,j) += pn[i][j];
+          vn_up(i,j) += np[i][j];
+          vn_un(i,j) += nn[i][j];
+        }
+    }
+
+    // scalar form of the interface integrals kept as the reference for the
+    // vectorized kernel
+    static void interface_reference
+    (const FEFaceValues<dim> &fvf,
+     const FEFaceValuesBase<dim> &fvf_nei,
+     const Tensor<1,dim> &omega,
+     const double sige,
+     const double half_ndo,
+     const double local_inv_sigt,
+     const double neigh_inv_sigt,
+     FullMatrix<double> &vp_up,
+     FullMatrix<double> &vp_un,
+     FullMatrix<double> &vn_up,
+     FullMatrix<double> &vn_un)
+    {
+      double vp[n_qf][n_dofs], vn[n_qf][n_dofs];
+      Tensor<1,dim> gp[n_qf][n_dofs], gn[n_qf][n_dofs];
+      double jxw[n_qf];
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+      {
+        jxw[qi] = fvf.JxW (qi);
+        for (unsigned int i=0; i<n_dofs; ++i)
+        {
+          vp[qi][i] = fvf.shape_value (i, qi);
+          vn[qi][i] = fvf_nei.shape_value (i, qi);
+          gp[qi][i] = fvf.shape_grad (i, qi);
+          gn[qi][i] = fvf_nei.shape_grad (i, qi);
+        }
+      }
+
+      double pp[n_dofs][n_dofs] = {}, pn[n_dofs][n_dofs] = {};
+      double np[n_dofs][n_dofs] = {}, nn[n_dofs][n_dofs] = {};
+      for (unsigned int qi=0; qi<n_qf; ++qi)
+        for (unsigned int i=0; i<n_dofs; ++i)
+          for (unsigned int j=0; j<n_dofs; ++j)
+          {
+            pp[i][j] += (sige * vp[qi][i] * vp[qi][j]
+                         -
+                         local_inv_sigt * half_ndo * (omega * gp[qi][i]) * vp[qi][j]
+                         -
+                         local_inv_sigt * half_ndo * vp[qi][i] * (omega * gp[qi][j])
+                         ) * jxw[qi];
+
+            pn[i][j] += (-sige * vp[qi][i] * vn[qi][j]
+                         +
+                         local_inv_sigt * half_ndo * (omega * gp[qi][i]) * vn[qi][j]
+                         -
+                         neigh_inv_sigt * half_ndo * vp[qi][i] * (omega * gn[qi][j])
+                         ) * jxw[qi];
+
+            np[i][j] += (-sige * vn[qi][i] * vp[qi][j]
+                         -
+                         neigh_inv_sigt * half_ndo * (omega * gn[qi][i]) * vp[qi][j]
+                         +
+                         local_inv_sigt * half_ndo * vn[qi][i] * (omega * gp[qi][j])
+                         ) * jxw[qi];
+
+            nn[i][j] += (sige * vn[qi][i] * vn[qi][j]
+                         +
+                         neigh_inv_sigt * half_ndo * (omega * gn[qi][i]) * vn[qi][j]
+                         +
+                         neigh_inv_sigt * half_ndo * vn[qi][i] * (omega * gn[qi][j])
+                         ) * jxw[qi];
+          }
+      for (unsigned int i=0; i<n_dofs; ++i)
+        for (unsigned int j=0; j<n_dofs; ++j)
+        {
+          vp_up(i,j) += pp[i][j];
+          vp_un(i,j) += pn[i][j];
+          vn_up(i,j) += np[i][j];
+          vn_un(i,j) += nn[i][j];
+        }
+    }
+  };
+}
+
 template <int dim>
 EvenParity<dim>::EvenParity (ParameterHandler &prm)
 :
@@ -39,15 +362,36 @@ void EvenParity<dim>::pre_assemble_cell_matrices
 
 template <int dim>
 void EvenParity<dim>::integrate_cell_bilinear_form
-(const std_cxx11::shared_ptr<FEValues<dim> > fv,
- typename DoFHandler<dim>::active_cell_iterator &cell,
+(unsigned int &ic,/*local cell index*/
  FullMatrix<double> &cell_matrix,
  unsigned int &i_dir,
  unsigned int &g,
  std::vector<std::vector<FullMatrix<double> > > &streaming_at_qp,
  std::vector<FullMatrix<double> > &collision_at_qp)
 {
-  unsigned int mid = cell->material_id ();
+  unsigned int mid = this->cell_material_ids[ic];
+  const std::vector<double> &jxw = this->cell_jxw[ic];
+  switch (this->p_order)
+  {
+    case 1:
+      EPKernel<dim,1>::cell (streaming_at_qp, collision_at_qp, jxw, i_dir,
+                             this->all_inv_sigt[mid][g], this->all_sigt[mid][g],
+                             cell_matrix);
+      return;
+    case 2:
+      EPKernel<dim,2>::cell (streaming_at_qp, collision_at_qp, jxw, i_dir,
+                             this->all_inv_sigt[mid][g], this->all_sigt[mid][g],
+                             cell_matrix);
+      return;
+    case 3:
+      EPKernel<dim,3>::cell (streaming_at_qp, collision_at_qp, jxw, i_dir,
+                             this->all_inv_sigt[mid][g], this->all_sigt[mid][g],
+                             cell_matrix);
+      return;
+    default:
+      break;
+  }
+  // generic path for higher orders
   for (unsigned int qi=0; qi<this->n_q; ++qi)
     for (unsigned int i=0; i<this->dofs_per_cell; ++i)
       for (unsigned int j=0; j<this->dofs_per_cell; ++j)
@@ -55,23 +399,50 @@ void EvenParity<dim>::integrate_cell_bilinear_form
                              this->all_inv_sigt[mid][g]
                              +
                              collision_at_qp[qi](i,j) *
-                             this->all_sigt[mid][g]) * fv->JxW(qi);
+                             this->all_sigt[mid][g]) * jxw[qi];
 }
 
 template <int dim>
 void EvenParity<dim>::integrate_boundary_bilinear_form
 (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
- typename DoFHandler<dim>::active_cell_iterator &cell,
+ unsigned int &ic,/*local cell index*/
  unsigned int &fn,/*face number*/
  FullMatrix<double> &cell_matrix,
  unsigned int &i_dir,
  unsigned int &g)
 {
-  unsigned int bd_id = cell->face(fn)->boundary_id ();
-  const Tensor<1,dim> vec_n = fvf->normal_vector(0);
-  if (this->have_reflective_bc && this->is_reflective_bc[bd_id])
+  unsigned int f = ic * GeometryInfo<dim>::faces_per_cell + fn;
+  unsigned int bd_id = this->face_boundary_ids[f];
+  const Tensor<1,dim> &vec_n = this->face_normals[f];
+  if (this->have_reflective_bc && this->is_reflective_bc[bd_id] &&
+      !this->is_explicit_reflective)
+  {
+    // Symmetric coupling to the reflected direction r: the diagonal block
+    // (1/2) [lambda(psi) v + lambda(v) psi] + kappa psi v is implicit, with
+    // lambda(u) = -(n.omega)/sigt omega.grad(u) the boundary odd-parity flux,
+    // while the matching terms in psi_r are added to the right-hand side by
+    // add_reflective_coupling_source. A direction reflected onto itself
+    // satisfies the condition naturally.
+    if (this->get_reflective_direction_index (bd_id, i_dir)==i_dir)
+      return;
+    const Tensor<1,dim> &omega = this->omega_i[i_dir];
+    const double inv_sigt = this->all_inv_sigt[this->cell_material_ids[ic]][g];
+    const double half_ndo_inv_sigt = 0.5 * (vec_n * omega) * inv_sigt;
+    const double kappa = get_reflective_penalty (ic, fn, omega, g);
+    for (unsigned int qi=0; qi<this->n_qf; ++qi)
+      for (unsigned int i=0; i<this->dofs_per_cell; ++i)
+        for (unsigned int j=0; j<this->dofs_per_cell; ++j)
+          cell_matrix(i,j) += ((- half_ndo_inv_sigt *
+                                (fvf->shape_value(i,qi) * (omega * fvf->shape_grad(j,qi)) +
+                                 (omega * fvf->shape_grad(i,qi)) * fvf->shape_value(j,qi)) +
+                                kappa *
+                                fvf->shape_value(i,qi) *
+                                fvf->shape_value(j,qi)) *
+                               fvf->JxW(qi));
+  }
+  else if (this->have_reflective_bc && this->is_reflective_bc[bd_id])
   {
-    unsigned int inv_sigt = this->all_inv_sigt[cell->material_id()][g];
+    double inv_sigt = this->all_inv_sigt[this->cell_material_ids[ic]][g];
     // hard coded part
     Tensor<1, dim> ref_angle =
     this->omega_i[i_dir] - 2.0 * (this->omega_i[i_dir] * vec_n) * vec_n;
@@ -79,6 +450,20 @@ void EvenParity<dim>::integrate_boundary_bilinear_form
     //unsigned int r_dir = this->get_reflective_direction_index (bd_id, i_dir);
     //ref_angle = this->omega_i[r_dir];
     double ndo_inv_sigt = vec_n * this->omega_i[i_dir] * inv_sigt;
+    switch (this->p_order)
+    {
+      case 1:
+        EPKernel<dim,1>::reflective_boundary (*fvf, ref_angle, ndo_inv_sigt, cell_matrix);
+        return;
+      case 2:
+        EPKernel<dim,2>::reflective_boundary (*fvf, ref_angle, ndo_inv_sigt, cell_matrix);
+        return;
+      case 3:
+        EPKernel<dim,3>::reflective_boundary (*fvf, ref_angle, ndo_inv_sigt, cell_matrix);
+        return;
+      default:
+        break;
+    }
     for (unsigned int qi=0; qi<this->n_qf; ++qi)
       for (unsigned int i=0; i<this->dofs_per_cell; ++i)
         for (unsigned int j=0; j<this->dofs_per_cell; ++j)
@@ -91,6 +476,20 @@ void EvenParity<dim>::integrate_boundary_bilinear_form
            (this->have_reflective_bc && !this->is_reflective_bc[bd_id]))*/
   {
     double absndo = std::fabs (vec_n * this->omega_i[i_dir]);
+    switch (this->p_order)
+    {
+      case 1:
+        EPKernel<dim,1>::vacuum_boundary (*fvf, absndo, cell_matrix);
+        return;
+      case 2:
+        EPKernel<dim,2>::vacuum_boundary (*fvf, absndo, cell_matrix);
+        return;
+      case 3:
+        EPKernel<dim,3>::vacuum_boundary (*fvf, absndo, cell_matrix);
+        return;
+      default:
+        break;
+    }
     for (unsigned int qi=0; qi<this->n_qf; ++qi)
       for (unsigned int i=0; i<this->dofs_per_cell; ++i)
         for (unsigned int j=0; j<this->dofs_per_cell; ++j)
@@ -101,12 +500,28 @@ void EvenParity<dim>::integrate_boundary_bilinear_form
   }// non-ref bd
 }
 
+// Penalty of the symmetric reflective coupling, scaled like the interior
+// penalty by (n.omega)^2/sigt times p(p+1)|face|/|cell| and bounded below by
+// the vacuum boundary coefficient |n.omega|/2.
+template <int dim>
+double EvenParity<dim>::get_reflective_penalty (unsigned int ic,
+                                                unsigned int fn,
+                                                const Tensor<1,dim> &omega,
+                                                unsigned int g)
+{
+  unsigned int f = ic * GeometryInfo<dim>::faces_per_cell + fn;
+  const double absndo = std::fabs (this->face_normals[f] * omega);
+  const double inv_sigt = this->all_inv_sigt[this->cell_material_ids[ic]][g];
+  return absndo * std::max (0.5,
+                            this->p_order * (this->p_order + 1.0) * absndo * inv_sigt *
+                            this->face_measures[f] / this->cell_measures[ic]);
+}
+
 template <int dim>
 void EvenParity<dim>::integrate_interface_bilinear_form
 (const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf,
- const std_cxx11::shared_ptr<FEFaceValues<dim> > fvf_nei,
- typename DoFHandler<dim>::active_cell_iterator &cell,
- typename DoFHandler<dim>::cell_iterator &neigh,/*cell iterator for cell*/
+ const std_cxx11::shared_ptr<FEFaceValuesBase<dim> > fvf_nei,
+ unsigned int &ic,/*local cell index*/
  unsigned int &fn,/*concerning face number in local cell*/
  unsigned int &i_dir,
  unsigned int &g,
@@ -115,16 +530,17 @@ void EvenParity<dim>::integrate_interface_bilinear_form
  FullMatrix<double> &vn_up,
  FullMatrix<double> &vn_un)
 {
-  const Tensor<1,dim> vec_n = fvf->normal_vector (0);
-  unsigned int mid = cell->material_id ();
-  unsigned int mid_nei = neigh->material_id ();
+  unsigned int f = ic * GeometryInfo<dim>::faces_per_cell + fn;
+  const Tensor<1,dim> &vec_n = this->face_normals[f];
+  unsigned int mid = this->cell_material_ids[ic];
+  unsigned int mid_nei = this->face_neighbor_material_ids[f];
   double local_sigt = this->all_sigt[mid][g];
   double local_inv_sigt = this->all_inv_sigt[mid][g];
-  double local_measure = cell->measure ();
+  double local_measure = this->cell_measures[ic];
   double neigh_sigt = this->all_sigt[mid_nei][g];
   double neigh_inv_sigt = this->all_inv_sigt[mid_nei][g];
-  double neigh_measure = neigh->measure ();
-  double face_measure = cell->face(fn)->measure ();
+  double neigh_measure = this->face_neighbor_measures[f];
+  double face_measure = this->face_measures[f];
 
   double avg_mfp_inv = 0.5 * (face_measure / (local_sigt * local_measure)
                               + face_measure / (neigh_sigt * neigh_measure));
@@ -132,6 +548,26 @@ void EvenParity<dim>::integrate_interface_bilinear_form
 
   double half_ndo = 0.5 * vec_n * this->omega_i[i_dir];
   //double sige = std::max(std::fabs (ndo),0.25);
+  switch (this->p_order)
+  {
+    case 1:
+      EPKernel<dim,1>::interface (*fvf, *fvf_nei, this->omega_i[i_dir],
+                                  sige, half_ndo, local_inv_sigt, neigh_inv_sigt,
+                                  vp_up, vp_un, vn_up, vn_un);
+      return;
+    case 2:
+      EPKernel<dim,2>::interface (*fvf, *fvf_nei, this->omega_i[i_dir],
+                                  sige, half_ndo, local_inv_sigt, neigh_inv_sigt,
+                                  vp_up, vp_un, vn_up, vn_un);
+      return;
+    case 3:
+      EPKernel<dim,3>::interface (*fvf, *fvf_nei, this->omega_i[i_dir],
+                                  sige, half_ndo, local_inv_sigt, neigh_inv_sigt,
+                                  vp_up, vp_un, vn_up, vn_un);
+      return;
+    default:
+      break;
+  }
   for (unsigned int qi=0; qi<this->n_qf; ++qi)
     for (unsigned int i=0; i<this->dofs_per_cell; ++i)
       for (unsigned int j=0; j<this->dofs_per_cell; ++j)
@@ -191,78 +627,170 @@ void EvenParity<dim>::integrate_interface_bilinear_form
 
 }
 
+template <int dim>
+void EvenParity<dim>::assemble_scattering_source
+(const std::vector<Vector<double> > &sflxes,
+ unsigned int g,
+ LA::MPI::Vector &rhs)
+{
+  rhs = 0.0;
+  std::vector<std::vector<double> > local_sflxes
+  (this->n_group, std::vector<double>(this->n_q));
+  for (unsigned int ic=0; ic<this->local_cells.size (); ++ic)
+  {
+    Vector<double> cell_rhs (this->dofs_per_cell);
+    unsigned int mid = this->cell_material_ids[ic];
+    for (unsigned int gin=0; gin<this->n_group; ++gin)
+      this->get_cell_values_at_qp (sflxes[gin], ic, local_sflxes[gin]);
+    
+    for (unsigned int qi=0; qi<this->n_q; ++qi)
+    {
+      double q_at_qp = 0.0;
+      for (unsigned int gin=0; gin<this->n_group; ++gin)
+        q_at_qp += (this->all_sigs_per_ster[mid][gin][g]<1.0e-13?0.0:
+                    (this->all_sigs_per_ster[mid][gin][g] * local_sflxes[gin][qi]));
+      for (unsigned int i=0; i<this->dofs_per_cell; ++i)
+        cell_rhs (i) += this->vec_test_at_qp[ic](qi, i) * q_at_qp;
+    }
+    this->constraints.distribute_local_to_global (cell_rhs,
+                                                  this->cell_dof_indices[ic],
+                                                  rhs);
+  }// local cells
+  rhs.compress (VectorOperation::add);
+}
+
 template <int dim>
 void EvenParity<dim>::generate_ho_rhs ()
 {
   for (unsigned int g=0; g<this->n_group; ++g)
-    for (unsigned int i_dir=0; i_dir<this->n_dir; ++i_dir)
+    for (unsigned int i_dir=this->component_layout.first_direction (g);
+         i_dir<this->component_layout.end_direction (g); ++i_dir)
     {
       unsigned int k = this->get_component_index (i_dir, g);
-      if (i_dir==0 && !this->do_nda)
+      const unsigned int k_first =
+      this->get_component_index (this->component_layout.first_direction (g), g);
+      if (k==k_first && !this->do_nda)
       {
-        *(this->vec_ho_rhs[k]) = 0.0;
-        for (unsigned int ic=0; ic<this->local_cells.size (); ++ic)
-        {
-          Vector<double> cell_rhs (this->dofs_per_cell);
-          typename DoFHandler<dim>::active_cell_iterator cell = this->local_cells[ic];
-          cell->get_dof_indices (this->local_dof_indices);
-          this->fv->reinit (cell);
-          unsigned int mid = cell->material_id ();
-          std::vector<std::vector<double> > local_sflxes
-          (this->n_group, std::vector<double>(this->n_q));
-          for (unsigned int gin=0; gin<this->n_group; ++gin)
-            this->fv->get_function_values (this->sflx_proc[gin], local_sflxes[gin]);
-          
-          for (unsigned int qi=0; qi<this->n_q; ++qi)
-          {
-            double q_at_qp = 0.0;
-            for (unsigned int gin=0; gin<this->n_group; ++gin)
-              q_at_qp += (this->all_sigs_per_ster[mid][gin][g]<1.0e-13?0.0:
-                          (this->all_sigs_per_ster[mid][gin][g] * local_sflxes[gin][qi]));
-            for (unsigned int i=0; i<this->dofs_per_cell; ++i)
-              cell_rhs (i) += this->vec_test_at_qp[ic](qi, i) * q_at_qp;
-          }
-          this->vec_ho_rhs[k]->add (this->local_dof_indices, cell_rhs);
-        }// local cells
-        this->vec_ho_rhs[k]->compress (VectorOperation::add);
+        assemble_scattering_source (this->sflx_proc, g, *(this->vec_ho_rhs[k]));
         *(this->vec_ho_rhs[k]) += *(this->vec_ho_fixed_rhs[k]);
       }// zeroth direction per group
       else
-        *(this->vec_ho_rhs[k]) = *(this->vec_ho_rhs[this->get_component_index(0, g)]);
+        *(this->vec_ho_rhs[k]) = *(this->vec_ho_rhs[k_first]);
     // Note that reflective boundary condition is carreid out using explicit reflective
-    // algorithm. See Memo 2 for details.
+    // algorithm by default. See Memo 2 for details.
     }// i_dir
+  std::vector<unsigned int> components (this->n_total_ho_vars);
+  for (unsigned int k=0; k<this->n_total_ho_vars; ++k)
+    components[k] = k;
+  add_reflective_coupling_source (components);
+}
+
+// Right-hand side half of the symmetric reflective coupling, lagged by one
+// iteration: for component k on a reflective face with reflected partner r,
+// (1/2) lambda_r(psi_r) v + (1/2) lambda(v) psi_r + kappa psi_r v. Couplings
+// are grouped by partner so that only one ghosted partner flux is alive at a
+// time.
+template <int dim>
+void EvenParity<dim>::add_reflective_coupling_source
+(const std::vector<unsigned int> &components)
+{
+  if (!this->have_reflective_bc || this->is_explicit_reflective)
+    return;
+  std::map<unsigned int, std::vector<std::pair<unsigned int, unsigned int> > > couplings;
+  for (unsigned int i=0; i<components.size (); ++i)
+    for (auto it=this->is_reflective_bc.begin(); it!=this->is_reflective_bc.end(); ++it)
+      if (it->second)
+      {
+        const unsigned int k = components[i];
+        const unsigned int k_ref = this->get_reflected_component (k, it->first);
+        if (k_ref!=k)
+          couplings[k_ref].push_back (std::make_pair (k, it->first));
+      }
+  
+  LA::MPI::Vector partner_aflx (this->local_dofs,
+                                this->relevant_dofs,
+                                this->mpi_communicator);
+  std::vector<double> values (this->n_qf);
+  std::vector<Tensor<1, dim> > gradients (this->n_qf);
+  Vector<double> cell_rhs (this->dofs_per_cell);
+  for (auto it=couplings.begin(); it!=couplings.end(); ++it)
+  {
+    partner_aflx = *(this->vec_aflx[it->first]);
+    for (unsigned int c=0; c<it->second.size (); ++c)
+    {
+      const unsigned int k = it->second[c].first;
+      const unsigned int bd_id = it->second[c].second;
+      const unsigned int g = this->get_component_group (k);
+      const Tensor<1,dim> &omega = this->omega_i[this->get_component_direction (k)];
+      for (unsigned int i_face=0; i_face<this->reflective_faces.size (); ++i_face)
+      {
+        if (this->reflective_face_boundary_ids[i_face]!=bd_id)
+          continue;
+        unsigned int ic = this->reflective_faces[i_face].first;
+        unsigned int fn = this->reflective_faces[i_face].second;
+        unsigned int f = ic * GeometryInfo<dim>::faces_per_cell + fn;
+        const Tensor<1,dim> &vec_n = this->face_normals[f];
+        const Tensor<1,dim> ref_angle = omega - 2.0 * (omega * vec_n) * vec_n;
+        const double inv_sigt = this->all_inv_sigt[this->cell_material_ids[ic]][g];
+        const double half_ndo_inv_sigt = 0.5 * (vec_n * omega) * inv_sigt;
+        const double half_ref_ndo_inv_sigt = 0.5 * (vec_n * ref_angle) * inv_sigt;
+        const double kappa = get_reflective_penalty (ic, fn, omega, g);
+        
+        this->fvf->reinit (this->local_cells[ic], fn);
+        this->fvf->get_function_values (partner_aflx, values);
+        this->fvf->get_function_gradients (partner_aflx, gradients);
+        cell_rhs = 0.0;
+        for (unsigned int qi=0; qi<this->n_qf; ++qi)
+          for (unsigned int i=0; i<this->dofs_per_cell; ++i)
+            cell_rhs (i) += ((- half_ref_ndo_inv_sigt *
+                              (ref_angle * gradients[qi]) *
+                              this->fvf->shape_value(i,qi) -
+                              half_ndo_inv_sigt *
+                              (omega * this->fvf->shape_grad(i,qi)) *
+                              values[qi] +
+                              kappa *
+                              values[qi] *
+                              this->fvf->shape_value(i,qi)) *
+                             this->fvf->JxW(qi));
+        this->constraints.distribute_local_to_global (cell_rhs,
+                                                      this->cell_dof_indices[ic],
+                                                      *(this->vec_ho_rhs[k]));
+      }// reflective faces
+    }// couplings
+  }// partners
+  for (unsigned int i=0; i<components.size (); ++i)
+    this->vec_ho_rhs[components[i]]->compress (VectorOperation::add);
 }
 
 template <int dim>
 void EvenParity<dim>::generate_ho_fixed_source ()
 {
   for (unsigned int g=0; g<this->n_group; ++g)
-    for (unsigned int i_dir=0; i_dir<this->n_dir; ++i_dir)
+    for (unsigned int i_dir=this->component_layout.first_direction (g);
+         i_dir<this->component_layout.end_direction (g); ++i_dir)
     {
       unsigned int k = this->get_component_index (i_dir, g);
-      if (i_dir==0)
+      const unsigned int k_first =
+      this->get_component_index (this->component_layout.first_direction (g), g);
+      if (k==k_first)
       {
         *(this->vec_ho_fixed_rhs[k]) = 0.0;
+        std::vector<std::vector<double> > local_sflxes (this->n_group, std::vector<double>(this->n_q));
         for (unsigned int ic=0; ic<this->local_cells.size (); ++ic)
         {
           Vector<double> cell_rhs (this->dofs_per_cell);
-          typename DoFHandler<dim>::active_cell_iterator cell = this->local_cells[ic];
-          unsigned int mid = cell->material_id ();
+          unsigned int mid = this->cell_material_ids[ic];
           
           if ((this->is_eigen_problem && this->is_material_fissile[mid]) ||
               (!this->is_eigen_problem &&
                (this->do_nda || (!this->do_nda && this->all_q_per_ster[mid][g]>1.0e-13))))
           {
-            this->fv->reinit (cell);
-            cell->get_dof_indices (this->local_dof_indices);
-            std::vector<std::vector<double> > local_sflxes (this->n_group, std::vector<double>(this->n_q));
             for (unsigned int gin=0; gin<this->n_group; ++gin)
             {
               if (this->do_nda)
-                this->fv->get_function_values (this->lo_sflx_proc[gin], local_sflxes[gin]);
+                this->get_cell_values_at_qp (this->lo_sflx_proc[gin], ic, local_sflxes[gin]);
               else if (!this->do_nda && this->is_eigen_problem)
-                this->fv->get_function_values (this->sflx_proc_prev_gen[gin], local_sflxes[gin]);
+                this->get_cell_values_at_qp (this->sflx_proc_prev_gen[gin], ic, local_sflxes[gin]);
             }
             
             for (unsigned int qi=0; qi<this->n_q; ++qi)
@@ -295,14 +823,15 @@ void EvenParity<dim>::generate_ho_fixed_source ()
               for (unsigned int i=0; i<this->dofs_per_cell; ++i)
                 cell_rhs (i) += this->vec_test_at_qp[ic](qi, i) * q_at_qp;
             }
-            this->vec_ho_fixed_rhs[k]->add (this->local_dof_indices, cell_rhs);
+            this->constraints.distribute_local_to_global (cell_rhs,
+                                                          this->cell_dof_indices[ic],
+                                                          *(this->vec_ho_fixed_rhs[k]));
           }// when to calculate rhs
         }// loop over local cells
         this->vec_ho_fixed_rhs[k]->compress (VectorOperation::add);
       }// first direction per group
       else
-        *(this->vec_ho_fixed_rhs[k]) =
-        *(this->vec_ho_fixed_rhs[this->get_component_index(0, g)]);
+        *(this->vec_ho_fixed_rhs[k]) = *(this->vec_ho_fixed_rhs[k_first]);
     }
 }
 
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Compare keff and scalar flux of two xtrans runs.
+
+    compare_runs.py REFERENCE CASE [--tolerance TOL]
+
+REFERENCE and CASE are output file name bases of runs on the same mesh and
+processor count with "output format = gnuplot" and a telemetry file named
+<base>-telemetry.jsonl. keff must agree within TOL relative, and every
+flux column within TOL of the reference maximum of that column. The source
+iterations and generations of both runs are reported. Exits nonzero on a
+mismatch.
+"""
+
+import argparse
+import glob
+import json
+import sys
+
+
+def read_telemetry(base):
+    keff, sweeps, generations = None, 0, 0
+    with open(base + "-telemetry.jsonl") as stream:
+        for line in stream:
+            record = json.loads(line)
+            if record["event"] == "si":
+                sweeps += 1
+            else:
+                generations += 1
+                keff = record["keff"]
+    return keff, sweeps, generations
+
+
+def read_flux(base):
+    """Maps rounded point coordinates to the sorted values of each column."""
+    files = sorted(glob.glob(base + "-*[0-9][0-9][0-9][0-9].gnuplot"))
+    if not files:
+        sys.exit("no gnuplot output for " + base)
+    names, dim, points = None, 0, {}
+    for name in files:
+        with open(name) as f:
+            for line in f:
+                if line.startswith("# <"):
+                    names = line[1:].split()
+                    dim = sum(1 for c in names if c in ("<x>", "<y>", "<z>"))
+                    continue
+                fields = line.split()
+                if not fields or line.startswith("#"):
+                    continue
+                key = tuple(round(float(x), 9) for x in fields[:dim])
+                entry = points.setdefault(key, [[] for _ in fields[dim:]])
+                for values, field in zip(entry, fields[dim:]):
+                    values.append(float(field))
+    for entry in points.values():
+        for values in entry:
+            values.sort()
+    return [c.strip("<>") for c in names[dim:]], points
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("reference")
+    parser.add_argument("case")
+    parser.add_argument("--tolerance", type=float, default=1e-5)
+    args = parser.parse_args()
+
+    failed = False
+    (k_ref, si_ref, pi_ref), (k, si, pi) = (read_telemetry(args.reference),
+                                            read_telemetry(args.case))
+    err_k = abs(k - k_ref) / abs(k_ref)
+    print("%-10s keff %.8f  SI %5d  PI %4d" % (args.reference, k_ref, si_ref, pi_ref))
+    print("%-10s keff %.8f  SI %5d  PI %4d" % (args.case, k, si, pi))
+    print("keff rel. err %.2e %s" % (err_k, "ok" if err_k <= args.tolerance else "MISMATCH"))
+    failed = err_k > args.tolerance
+
+    names, ref_points = read_flux(args.reference)
+    case_names, points = read_flux(args.case)
+    if case_names != names or set(points) != set(ref_points):
+        sys.exit("the runs have different meshes or output columns")
+    for i, name in enumerate(names):
+        if name == "subdomain":
+            continue
+        scale = max(abs(v) for entry in ref_points.values() for v in entry[i])
+        diff = max(abs(a - b) for key, entry in ref_points.items()
+                   for a, b in zip(entry[i], points[key][i]))
+        err = diff / scale
+        print("%s max rel. err %.2e %s"
+              % (name, err, "ok" if err <= args.tolerance else "MISMATCH"))
+        failed = failed or err > args.tolerance
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()